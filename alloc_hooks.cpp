@@ -0,0 +1,101 @@
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+
+#ifdef _MSC_VER
+#include <malloc.h>
+#endif
+
+#include "alloc_hooks.h"
+#include "instrumentation.h"
+#include "metrics.h"
+
+namespace {
+
+thread_local std::uint64_t allocations = 0;
+
+void count(std::size_t size) {
+    allocations++;
+    metrics::countAllocation();
+    instrument::countAllocation(size);
+}
+
+// Memory for over-aligned types (alignas above the default, such as the
+// analyzer's part sums and the cache's entries)
+void* alignedAllocate(std::size_t size, std::align_val_t alignment) {
+    std::size_t align = static_cast<std::size_t>(alignment);
+#ifdef _MSC_VER
+    void* memory = _aligned_malloc(size > 0 ? size : 1, align);
+#else
+    // aligned_alloc wants a whole number of alignments
+    void* memory = std::aligned_alloc(align, size > 0 ? (size + align - 1) / align * align : align);
+#endif
+    if (!memory) throw std::bad_alloc();
+    return memory;
+}
+
+void alignedFree(void* memory) {
+#ifdef _MSC_VER
+    _aligned_free(memory);
+#else
+    std::free(memory);
+#endif
+}
+
+} // namespace
+
+std::uint64_t alloc::threadAllocations() {
+    return allocations;
+}
+
+void* operator new(std::size_t size) {
+    count(size);
+    if (void* memory = std::malloc(size > 0 ? size : 1)) return memory;
+    throw std::bad_alloc();
+}
+
+void* operator new[](std::size_t size) {
+    return operator new(size);
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    count(size);
+    return alignedAllocate(size, alignment);
+}
+
+void* operator new[](std::size_t size, std::align_val_t alignment) {
+    return operator new(size, alignment);
+}
+
+void operator delete(void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory) noexcept {
+    std::free(memory);
+}
+
+void operator delete[](void* memory, std::size_t) noexcept {
+    std::free(memory);
+}
+
+void operator delete(void* memory, std::align_val_t) noexcept {
+    alignedFree(memory);
+}
+
+void operator delete(void* memory, std::size_t, std::align_val_t) noexcept {
+    alignedFree(memory);
+}
+
+void operator delete[](void* memory, std::align_val_t) noexcept {
+    alignedFree(memory);
+}
+
+void operator delete[](void* memory, std::size_t, std::align_val_t) noexcept {
+    alignedFree(memory);
+}
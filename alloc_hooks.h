@@ -0,0 +1,19 @@
+#ifndef DEALMASTER_ALLOC_HOOKS_H
+#define DEALMASTER_ALLOC_HOOKS_H
+
+#include <cstdint>
+
+// The programs replace the global operator new and delete with the
+// versions in alloc_hooks.cpp (part of dealmaster_core), in the plain,
+// array and over-aligned forms. Every allocation
+// is counted for the calling thread; while a metrics file is open it is
+// also counted for --metrics, and in an instrumented build it is charged
+// to the current game phase.
+namespace alloc {
+
+// Heap allocations made so far by the calling thread
+std::uint64_t threadAllocations();
+
+} // namespace alloc
+
+#endif // DEALMASTER_ALLOC_HOOKS_H
@@ -0,0 +1,384 @@
+#ifndef DEALMASTER_BANK_MODEL_H
+#define DEALMASTER_BANK_MODEL_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "game_variants.h"
+#include "money.h"
+#include "prize_board.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+// How the bank prices an offer.
+//
+// A model sees the rules, the round (1-based) and the set of prizes still in
+// play as a mask over board indices, and returns the offer in whole cents.
+// Models scaled by the round's multiplier round the unscaled offer to a
+// cent first and the scaled one again, so rescaling a table baked at
+// multiplier 1 gives exactly the offers of the game. Models hold no state, so each has one shared instance per board size.
+// Everything that evaluates many games (the simulator, the bank solver)
+// bakes a model into an OfferTable once and then reads offers by lookup.
+template <int N>
+class BasicBankModel {
+public:
+    using Mask = CaseMask<N>;
+    using Rules = BasicGameRules<N>;
+
+    virtual ~BasicBankModel() = default;
+
+    virtual const char* name() const = 0;
+
+    // Offer after `round` with the prizes in `remaining` still in play
+    virtual Cents offer(const Rules& rules, int round, Mask remaining) const = 0;
+
+    // Offers are proportional to the rules' per-round multipliers, so a
+    // table baked at multiplier 1 can be rescaled instead of rebaked
+    virtual bool scalesWithMultiplier() const {
+        return true;
+    }
+
+    // Models whose offer depends only on the sum and number of the prizes
+    // in play say so, and then price from running sums without a mask
+    virtual bool pricesByTotal() const {
+        return false;
+    }
+
+    // The offer with `count` prizes summing to `total` in play, for models
+    // that price by total
+    virtual Cents offerForTotal(const Rules& rules, int round, Cents total, int count) const {
+        (void)rules;
+        (void)round;
+        (void)total;
+        (void)count;
+        return 0;
+    }
+};
+
+namespace bank_detail {
+
+// Mean and population standard deviation of the prizes in `mask`
+template <int N>
+void moments(const BasicPrizeBoard<N>& board, CaseMask<N> mask, double& mean, double& deviation) {
+    double sum = 0.0;
+    double squares = 0.0;
+    int count = 0;
+    for (int i = N - 1; i >= 0; i--) {
+        if ((mask >> i) & 1u) {
+            sum += board.value[i];
+            squares += board.value[i] * board.value[i];
+            count++;
+        }
+    }
+    mean = count > 0 ? sum / count : 0.0;
+    double variance = count > 0 ? squares / count - mean * mean : 0.0;
+    deviation = variance > 0.0 ? std::sqrt(variance) : 0.0;
+}
+
+} // namespace bank_detail
+
+// The show's original bank: the round's multiplier times the mean
+template <int N>
+class MeanBankModel : public BasicBankModel<N> {
+public:
+    using typename BasicBankModel<N>::Mask;
+    using typename BasicBankModel<N>::Rules;
+
+    const char* name() const override {
+        return "mean";
+    }
+
+    Cents offer(const Rules& rules, int round, Mask remaining) const override {
+        // Branch-free: the bits of a baked mask are random
+        Cents sum = 0;
+        int count = 0;
+        for (int i = 0; i < N; i++) {
+            Cents bit = (remaining >> i) & 1u;
+            sum += rules.board.cents[i] & -bit;
+            count += static_cast<int>(bit);
+        }
+        return MeanBankModel::offerForTotal(rules, round, sum, count);
+    }
+
+    bool pricesByTotal() const override {
+        return true;
+    }
+
+    Cents offerForTotal(const Rules& rules, int round, Cents total, int count) const override {
+        if (count == 0) return 0;
+        return scaleCents(meanCents(total, count), rules.offerMultiplier[round - 1]);
+    }
+};
+
+// Discounts the mean by the spread of what is left: a board with one big
+// prize among small ones gets a lower offer than an even board of the same
+// mean. mean / (1 + Penalty * stddev / mean) stays positive on any board.
+template <int N>
+class VarianceBankModel : public BasicBankModel<N> {
+public:
+    using typename BasicBankModel<N>::Mask;
+    using typename BasicBankModel<N>::Rules;
+
+    static constexpr double Penalty = 0.25;
+
+    const char* name() const override {
+        return "variance";
+    }
+
+    Cents offer(const Rules& rules, int round, Mask remaining) const override {
+        double mean;
+        double deviation;
+        bank_detail::moments(rules.board, remaining, mean, deviation);
+        if (mean <= 0.0) return 0;
+        return scaleCents(toCents(mean / (1.0 + Penalty * deviation / mean)), rules.offerMultiplier[round - 1]);
+    }
+};
+
+// Offer curve of broadcast shows (Post et al., 2008): the share of the mean
+// starts low and each round closes part of the gap to a fair offer, faster
+// towards the end, reaching the full mean in the last round. It replaces
+// the rules' multipliers rather than scaling them.
+template <int N>
+class ShowBankModel : public BasicBankModel<N> {
+public:
+    using typename BasicBankModel<N>::Mask;
+    using typename BasicBankModel<N>::Rules;
+
+    static constexpr double FirstShare = 0.11;
+    static constexpr double Convergence = 0.777;
+
+    const char* name() const override {
+        return "show";
+    }
+
+    bool scalesWithMultiplier() const override {
+        return false;
+    }
+
+    // Share of the mean offered in `round` of `rounds`
+    static double share(int round, int rounds) {
+        double value = FirstShare;
+        for (int r = 2; r <= round; r++) {
+            double closed = 1.0;
+            for (int i = r; i < rounds; i++) closed *= Convergence;
+            value += (1.0 - value) * closed;
+        }
+        return value;
+    }
+
+    Cents offer(const Rules& rules, int round, Mask remaining) const override {
+        double mean;
+        double deviation;
+        bank_detail::moments(rules.board, remaining, mean, deviation);
+        return toCents(mean * share(round, rules.rounds));
+    }
+};
+
+// The round's multiplier times the median prize, which ignores how large
+// the top prizes are
+template <int N>
+class MedianBankModel : public BasicBankModel<N> {
+public:
+    using typename BasicBankModel<N>::Mask;
+    using typename BasicBankModel<N>::Rules;
+
+    const char* name() const override {
+        return "median";
+    }
+
+    Cents offer(const Rules& rules, int round, Mask remaining) const override {
+        int count = 0;
+        for (int i = 0; i < N; i++) count += (remaining >> i) & 1u;
+        if (count == 0) return 0;
+
+        // Board indices ascend with value, so the median is the middle set bit
+        int lower = (count - 1) / 2;
+        int upper = count / 2;
+        Cents middle = 0;
+        int seen = 0;
+        for (int i = 0; i < N && seen <= upper; i++) {
+            if (!((remaining >> i) & 1u)) continue;
+            if (seen == lower) middle += rules.board.cents[i];
+            if (seen == upper) middle += rules.board.cents[i];
+            seen++;
+        }
+        return scaleCents(meanCents(middle, 2), rules.offerMultiplier[round - 1]);
+    }
+};
+
+inline constexpr std::string_view BankModelNames[] = {"mean", "variance", "show", "median"};
+
+// The shared instance of the model called `name`, or nullptr
+template <int N>
+const BasicBankModel<N>* findBankModel(std::string_view name) {
+    static const MeanBankModel<N> mean;
+    static const VarianceBankModel<N> variance;
+    static const ShowBankModel<N> show;
+    static const MedianBankModel<N> median;
+    const BasicBankModel<N>* models[] = {&mean, &variance, &show, &median};
+    for (const BasicBankModel<N>* model : models) {
+        if (name == model->name()) return model;
+    }
+    return nullptr;
+}
+
+// Dense rank of a k-prize mask among all k-prize masks of a board, in
+// increasing numeric order (the combinatorial number system):
+// rank = C(p1, 1) + C(p2, 2) + ... + C(pk, k) for set bits p1 < ... < pk.
+template <int N>
+class MaskRanker {
+public:
+    using Mask = CaseMask<N>;
+
+private:
+    std::uint32_t choose[N + 1][N + 1];
+
+public:
+    MaskRanker() {
+        for (int n = 0; n <= N; n++) {
+            choose[n][0] = 1;
+            for (int k = 1; k <= N; k++) {
+                choose[n][k] = n == 0 ? 0 : choose[n - 1][k - 1] + choose[n - 1][k];
+            }
+        }
+    }
+
+    std::uint32_t binomial(int n, int k) const {
+        return choose[n][k];
+    }
+
+    std::uint32_t rank(Mask mask) const {
+        std::uint32_t result = 0;
+        int k = 0;
+        for (int i = 0; i < N; i++) {
+            if ((mask >> i) & 1u) result += choose[i][++k];
+        }
+        return result;
+    }
+
+    // The `bits`-prize mask of rank `index`
+    Mask unrank(std::uint32_t index, int bits) const {
+        Mask mask = 0;
+        int position = N - 1;
+        for (int k = bits; k >= 1; k--) {
+            while (choose[position][k] > index) position--;
+            mask = static_cast<Mask>(mask | (1u << position));
+            index -= choose[position][k];
+            position--;
+        }
+        return mask;
+    }
+};
+
+// Call work(part, mask, rank) for every `bits`-bit mask below 1 << n, in
+// increasing order. The masks are split by rank into up to `threads`
+// contiguous parts of at least `grain` masks, each run on its own thread
+// from its unranked first mask; `part` numbers them so callers can keep
+// per-thread sums.
+template <int N, class Work>
+void forEachMaskInParallel(const MaskRanker<N>& ranker, int n, int bits, int threads, const Work& work,
+                           std::uint32_t grain = 4096) {
+    std::uint32_t count = ranker.binomial(n, bits);
+    int parts = static_cast<int>(std::min<std::uint32_t>(static_cast<std::uint32_t>(std::max(1, threads)),
+                                                         count / grain + 1));
+
+    auto range = [&](int part) {
+        std::uint32_t begin = static_cast<std::uint32_t>(static_cast<std::uint64_t>(count) * part / parts);
+        std::uint32_t end = static_cast<std::uint32_t>(static_cast<std::uint64_t>(count) * (part + 1) / parts);
+        trace::Span span("masks", "parallel", "count", end - begin);
+        std::uint64_t mask = ranker.unrank(begin, bits);
+        for (std::uint32_t index = begin; index < end; index++) {
+            work(part, static_cast<CaseMask<N>>(mask), index);
+            if (index + 1 == end) break;
+            std::uint64_t low = mask & (~mask + 1);
+            std::uint64_t ripple = mask + low;
+            mask = ripple | (((mask ^ ripple) >> 2) / low);
+        }
+    };
+
+    std::vector<std::thread> workers;
+    for (int part = 1; part < parts; part++) workers.emplace_back(range, part);
+    range(0);
+    for (std::thread& worker : workers) worker.join();
+}
+
+// A bank model baked for every state at which an offer is made: one entry
+// per (round, set of prizes in play). With a valid schedule the number of
+// prizes in play at each offer is fixed, so round r holds C(N, k_r) offers,
+// stored contiguously in mask order. The standard board bakes 17.5 million
+// offers (140 MB); the 22- and 16-case boards are far smaller.
+template <int N>
+class BasicOfferTable {
+public:
+    using Mask = CaseMask<N>;
+    using Rules = BasicGameRules<N>;
+
+private:
+    MaskRanker<N> ranker;
+    std::vector<Cents> offers;
+    std::size_t roundStart[MaxScheduleRounds + 1];
+    int inPlay[MaxScheduleRounds];
+    int rounds;
+
+public:
+    BasicOfferTable() : roundStart{}, inPlay{}, rounds(0) {}
+
+    void bake(const BasicBankModel<N>& model, const Rules& rules) {
+        trace::Span span("bake offers", "bank");
+        rounds = rules.rounds;
+        std::size_t total = 0;
+        int left = N;
+        for (int r = 0; r < rounds; r++) {
+            left -= rules.casesPerRound[r];
+            inPlay[r] = left;
+            roundStart[r] = total;
+            total += ranker.binomial(N, left);
+        }
+        roundStart[rounds] = total;
+        offers.assign(total, 0);
+
+        // Masks with k bits set, in increasing order (Gosper's hack), so the
+        // entry index simply counts up
+        for (int r = 0; r < rounds; r++) {
+            std::uint64_t mask = (1ULL << inPlay[r]) - 1;
+            std::uint64_t end = 1ULL << N;
+            Cents* entry = offers.data() + roundStart[r];
+            while (mask < end) {
+                *entry++ = model.offer(rules, r + 1, static_cast<Mask>(mask));
+                std::uint64_t low = mask & (~mask + 1);
+                std::uint64_t ripple = mask + low;
+                mask = ripple | (((mask ^ ripple) >> 2) / low);
+            }
+        }
+    }
+
+    // Offer after `round` with the prizes in `remaining` in play; the mask
+    // must hold prizesInPlay(round) bits
+    Cents offer(int round, Mask remaining) const {
+        return offers[roundStart[round - 1] + ranker.rank(remaining)];
+    }
+
+    // The offers of `round`, in increasing mask order
+    const Cents* roundOffers(int round) const {
+        return offers.data() + roundStart[round - 1];
+    }
+
+    int prizesInPlay(int round) const {
+        return inPlay[round - 1];
+    }
+
+    std::size_t size() const {
+        return offers.size();
+    }
+
+    const MaskRanker<N>& masks() const {
+        return ranker;
+    }
+};
+
+#endif // DEALMASTER_BANK_MODEL_H
@@ -0,0 +1,181 @@
+#ifndef DEALMASTER_BANK_SOLVER_H
+#define DEALMASTER_BANK_SOLVER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "bank_model.h"
+#include "game_variants.h"
+#include "player_policy.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+// Exact value of one offer schedule against a player policy
+struct PolicyEvaluation {
+    double payout = 0.0;        // Expected bank payout per game
+    double reach = 0.0;         // P(the game is still on at the offer of the constrained round)
+};
+
+struct SolverResult {
+    double multipliers[MaxScheduleRounds] = {};
+    PolicyEvaluation evaluation;
+    bool feasible = false;
+    int evaluations = 0;
+};
+
+// Chooses the bank's per-round offer multipliers to minimise the expected
+// payout subject to P(game reaches round k) >= target, for a given player
+// policy. It alternates exact policy evaluation with a pattern search over
+// the multipliers.
+//
+// Evaluation is a backward pass over prize masks. The state at the offer
+// of round r is the set of prizes in play, a uniformly random set of fixed
+// size; the value of a state is p * offer + (1 - p) * E[value of the next
+// round's state]. The expectation over the cases opened in between is
+// taken one case at a time: the value of a set is the mean over its
+// members of the value without that member. Values live in arrays indexed
+// directly by mask (2^N entries, so 768 MB for the standard board), every
+// popcount level in its own disjoint slots, and each level is split across
+// threads by mask rank. Offers come from the bank model baked once at
+// multiplier 1 and are rescaled per schedule, to the cent as in the game.
+template <class Variant>
+class BankSolver {
+public:
+    static constexpr int Cases = Variant::Cases;
+    using Mask = CaseMask<Cases>;
+    using Rules = BasicGameRules<Cases>;
+
+    static constexpr double InitialStep = 0.05;
+    static constexpr double MinStep = 0.0025;
+    static constexpr double MinMultiplier = 0.01;
+    static constexpr double MaxMultiplier = 2.0;
+
+private:
+    const Rules& rules;
+    const BasicPlayerPolicy<Cases>& player;
+    BasicOfferTable<Cases> unitOffers;
+    int reachRound;
+    int threads;
+    std::vector<double> value;      // Expected payout from each state
+    std::vector<float> reach;       // P(reaching reachRound) from each state
+
+    // Turn continuation values into values at the offer of `round`
+    void decide(int round, double multiplier) {
+        const Cents* base = unitOffers.roundOffers(round);
+        bool last = round == rules.rounds;
+        int bits = unitOffers.prizesInPlay(round);
+        trace::Span span("decide", "solver", "round", round);
+        forEachMaskInParallel(unitOffers.masks(), Cases, bits, threads, [&](int, Mask mask, std::uint32_t index) {
+            double offer = toDollars(scaleCents(base[index], multiplier));
+            double accept = player.acceptProbability(rules.board, round, mask, offer);
+
+            double later;
+            float laterReach;
+            if (last) {
+                // No deal: the player's case is equally likely to be either prize left
+                Cents sum = 0;
+                int count = 0;
+                for (int i = 0; i < Cases; i++) {
+                    if ((mask >> i) & 1u) {
+                        sum += rules.board.cents[i];
+                        count++;
+                    }
+                }
+                later = toDollars(sum) / count;
+                laterReach = 0.0f;
+            } else {
+                later = value[mask];
+                laterReach = reach[mask];
+            }
+            value[mask] = accept * offer + (1.0 - accept) * later;
+            reach[mask] = round >= reachRound ? 1.0f : static_cast<float>((1.0 - accept) * laterReach);
+        });
+    }
+
+    // Value of each `bits`-prize set before one more case is opened
+    void average(int bits) {
+        trace::Span span("average", "solver", "prizes", bits);
+        forEachMaskInParallel(unitOffers.masks(), Cases, bits, threads, [&](int, Mask mask, std::uint32_t) {
+            double sum = 0.0;
+            float reachSum = 0.0f;
+            for (Mask rest = mask; rest != 0; rest = static_cast<Mask>(rest & (rest - 1))) {
+                Mask without = static_cast<Mask>(mask ^ (rest & (~rest + 1)));
+                sum += value[without];
+                reachSum += reach[without];
+            }
+            value[mask] = sum / bits;
+            reach[mask] = reachSum / bits;
+        });
+    }
+
+    bool better(const SolverResult& candidate, const SolverResult& incumbent) const {
+        if (candidate.feasible != incumbent.feasible) return candidate.feasible;
+        if (candidate.feasible) return candidate.evaluation.payout < incumbent.evaluation.payout * (1.0 - 1e-9);
+        return candidate.evaluation.reach > incumbent.evaluation.reach + 1e-9;
+    }
+
+public:
+    // `constrainedRound` is the round k of the engagement constraint
+    BankSolver(const Rules& gameRules, const BasicBankModel<Cases>& bank, const BasicPlayerPolicy<Cases>& policy,
+               int constrainedRound, int threadCount)
+        : rules(gameRules), player(policy), reachRound(constrainedRound), threads(std::max(1, threadCount)),
+          value(std::size_t(1) << Cases), reach(std::size_t(1) << Cases) {
+        Rules unit = rules;
+        for (int r = 0; r < unit.rounds; r++) unit.offerMultiplier[r] = 1.0;
+        unitOffers.bake(bank, unit);
+    }
+
+    // Exact expected payout and reach probability of one schedule
+    PolicyEvaluation evaluate(const double* multipliers) {
+        trace::Span span("evaluate", "solver");
+        for (int round = rules.rounds; round >= 1; round--) {
+            decide(round, multipliers[round - 1]);
+            int top = round > 1 ? unitOffers.prizesInPlay(round - 1) : Cases;
+            for (int bits = unitOffers.prizesInPlay(round) + 1; bits <= top; bits++) average(bits);
+        }
+        PolicyEvaluation result;
+        result.payout = value[rules.board.allMask];
+        result.reach = reach[rules.board.allMask];
+        return result;
+    }
+
+    // Pattern search from `start`: move one multiplier at a time by the
+    // current step while that improves the schedule, halving the step when
+    // no move does. `progress` sees every accepted schedule.
+    SolverResult optimize(const double* start, double target,
+                          const std::function<void(const SolverResult&)>& progress = nullptr) {
+        SolverResult best;
+        std::copy(start, start + rules.rounds, best.multipliers);
+        best.evaluation = evaluate(best.multipliers);
+        best.feasible = best.evaluation.reach >= target;
+        best.evaluations = 1;
+        if (progress) progress(best);
+
+        for (double step = InitialStep; step >= MinStep;) {
+            bool moved = false;
+            for (int r = 0; r < rules.rounds; r++) {
+                for (double direction : {-1.0, 1.0}) {
+                    SolverResult trial = best;
+                    trial.multipliers[r] = std::clamp(best.multipliers[r] + direction * step, MinMultiplier, MaxMultiplier);
+                    if (trial.multipliers[r] == best.multipliers[r]) continue;
+                    trial.evaluation = evaluate(trial.multipliers);
+                    trial.feasible = trial.evaluation.reach >= target;
+                    trial.evaluations = ++best.evaluations;
+                    if (better(trial, best)) {
+                        best = trial;
+                        moved = true;
+                        if (progress) progress(best);
+                        break;
+                    }
+                }
+            }
+            if (!moved) step /= 2;
+        }
+        return best;
+    }
+};
+
+#endif // DEALMASTER_BANK_SOLVER_H
@@ -0,0 +1,255 @@
+// Microbenchmarks of the hot paths: the computer player's deal decision,
+// offer table lookups, single-thread simulation, the advisor's preview of
+// the opening round's offer (computed, and found in the server's shared
+// cache), the server's session state machine and 32-byte archive records
+// (one at a time, and in batches over every hardware thread). Each line
+// reports the best of a few timed repetitions.
+//
+//     dealmaster-bench [VARIANT...]      (default: every compiled variant)
+//
+// Build: see CMakeLists.txt (target dealmaster-bench)
+
+#include <algorithm>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bank_model.h"
+#include "compact_record.h"
+#include "computer_player.h"
+#include "frame_buffer.h"
+#include "game_session.h"
+#include "metrics.h"
+#include "offer_preview.h"
+#include "replay_log.h"
+#include "simulator.h"
+#include "text_writer.h"
+#include "transposition_cache.h"
+#include "variant_rules.h"
+
+namespace {
+
+constexpr int Repetitions = 5;
+
+// Results the optimizer must not discard
+volatile double sinkValue;
+volatile std::size_t sinkSize;
+
+FrameBuffer out(1);
+
+// Best time per operation of `body`, which performs `operations` operations
+template <class Body>
+double nanosecondsPerOperation(long long operations, const Body& body) {
+    double best = 0.0;
+    for (int repetition = 0; repetition < Repetitions; repetition++) {
+        auto started = std::chrono::steady_clock::now();
+        body();
+        double elapsed = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - started).count();
+        if (repetition == 0 || elapsed < best) best = elapsed;
+    }
+    return best / operations;
+}
+
+void report(std::string_view variant, std::string_view name, double nanoseconds) {
+    out.put(variant).repeat(' ', 12 - std::min<std::size_t>(variant.size(), 11));
+    out.put(name).repeat(' ', 22 - std::min<std::size_t>(name.size(), 21));
+    out.putFixed(nanoseconds, 1).put(" ns/op\n");
+    out.flush();
+}
+
+void benchDecision() {
+    const ComputerPlayer& player = ComputerPlayer::shared();
+    std::vector<double> prizes = {0.01, 5.0, 75.0, 400.0, 1000.0, 7500.0, 50000.0, 200000.0, 500000.0};
+    constexpr long long Calls = 2000000;
+    double nanoseconds = nanosecondsPerOperation(Calls, [&]() {
+        std::size_t accepted = 0;
+        for (long long i = 0; i < Calls; i++) {
+            // A different board each call, so the expected value cannot be hoisted
+            prizes[0] = static_cast<double>(i & 0xff);
+            accepted += player.shouldAcceptDeal(prizes, 20000.0 + static_cast<double>(i & 0xffff), 9);
+        }
+        sinkSize = accepted;
+    });
+    report("-", "shouldAcceptDeal", nanoseconds);
+}
+
+// Random complete games, packed and then expanded again
+void benchArchive() {
+    constexpr int Records = 4096;
+    std::vector<compact::GameLayout> games(Records);
+    std::vector<compact::GameRecord> records(Records);
+    std::uint64_t seedState = 3;
+    for (compact::GameLayout& game : games) {
+        for (int i = 0; i < compact::Cases; i++) game.casePrize[i] = static_cast<std::uint8_t>(i);
+        replay::shuffleWithSeed(replay::splitMix64(seedState), game.casePrize, compact::Cases);
+        for (int i = 0; i < compact::Cases; i++) game.openOrder[i] = static_cast<std::uint8_t>(i);
+        replay::shuffleWithSeed(replay::splitMix64(seedState), game.openOrder, compact::Cases);
+        game.playerCase = game.openOrder[compact::Slots];
+        game.openedCount = compact::Slots;
+        game.roundCount = compact::Rounds;
+        for (int r = 0; r < compact::Rounds; r++) game.openedPerRound[r] = static_cast<std::uint8_t>(r < 7 ? 3 : 2);
+        game.dealRound = 0;
+    }
+
+    constexpr long long Encodes = 1 << 20;
+    report("-", "record encode", nanosecondsPerOperation(Encodes, [&]() {
+        std::uint64_t total = 0;
+        for (long long i = 0; i < Encodes; i++) {
+            std::size_t slot = static_cast<std::size_t>(i & (Records - 1));
+            compact::encode(games[slot], records[slot]);
+            total += records[slot].words[0];
+        }
+        sinkSize = static_cast<std::size_t>(total);
+    }));
+
+    constexpr long long Decodes = 1 << 20;
+    report("-", "record decode", nanosecondsPerOperation(Decodes, [&]() {
+        compact::GameLayout game;
+        std::size_t total = 0;
+        for (long long i = 0; i < Decodes; i++) {
+            compact::decode(records[static_cast<std::size_t>(i & (Records - 1))], game);
+            total += game.casePrize[i % compact::Cases] + game.openOrder[0];
+        }
+        sinkSize = total;
+    }));
+
+    constexpr int Batches = 64;
+    int threads = static_cast<int>(std::max(1u, std::thread::hardware_concurrency()));
+    std::vector<compact::GameRecord> batch;
+    for (int copy = 0; copy < 16; copy++) batch.insert(batch.end(), records.begin(), records.end());
+    std::vector<compact::GameLayout> expanded(batch.size());
+    report("-", "record decodeMany x" + std::to_string(threads),
+           nanosecondsPerOperation(static_cast<long long>(Batches) * static_cast<long long>(batch.size()), [&]() {
+        std::size_t total = 0;
+        for (int b = 0; b < Batches; b++) {
+            compact::decodeMany(batch.data(), batch.size(), expanded.data(), threads);
+            total += expanded[static_cast<std::size_t>(b)].casePrize[0];
+        }
+        sinkSize = total;
+    }));
+}
+
+template <class Variant>
+void benchVariant(const BasicGameRules<Variant::Cases>& rules) {
+    constexpr int Cases = Variant::Cases;
+    using Mask = CaseMask<Cases>;
+    std::string_view name = Variant::Name;
+
+    BasicOfferTable<Cases> offers;
+    offers.bake(*findBankModel<Cases>("mean"), rules);
+
+    // Lookups of the last round's offers with random in-play masks
+    constexpr int Masks = 4096;
+    int round = rules.rounds;
+    std::vector<Mask> masks(Masks);
+    std::uint64_t seedState = 1;
+    for (Mask& mask : masks) {
+        std::uint8_t order[Cases];
+        for (int i = 0; i < Cases; i++) order[i] = static_cast<std::uint8_t>(i);
+        replay::shuffleWithSeed(replay::splitMix64(seedState), order, Cases);
+        mask = 0;
+        for (int i = 0; i < offers.prizesInPlay(round); i++) mask |= static_cast<Mask>(Mask(1) << order[i]);
+    }
+    constexpr long long Lookups = 1 << 22;
+    report(name, "offer lookup", nanosecondsPerOperation(Lookups, [&]() {
+        Cents total = 0;
+        for (long long i = 0; i < Lookups; i++) total += offers.offer(round, masks[i & (Masks - 1)]);
+        sinkValue = toDollars(total);
+    }));
+
+    constexpr long long Games = 200000;
+    Simulator<Variant> simulator(rules, offers);
+    report(name, "simulated game", nanosecondsPerOperation(Games, [&]() {
+        SimulationResult result;
+        simulator.run(Games, 1, result);
+        sinkValue = result.totalPayout.dollars();
+    }));
+
+    // Every way the opening round could go, C(N, cases opened before the first offer)
+    const BasicBankModel<Cases>& bank = *findBankModel<Cases>("mean");
+    report(name, "opening offer preview", nanosecondsPerOperation(1, [&]() {
+        OfferPreview preview;
+        previewNextOffer(rules, bank, 1, rules.board.allMask, rules.casesPerRound[0], 0, preview);
+        sinkValue = preview.mean;
+    }));
+
+    OfferPreviewCache previews(std::size_t(1) << 20, Replacement::KeepCostly, metrics::Cache::Preview);
+    constexpr long long Previews = 1000000;
+    report(name, "cached offer preview", nanosecondsPerOperation(Previews, [&]() {
+        OfferPreview preview;
+        double total = 0.0;
+        for (long long i = 0; i < Previews; i++) {
+            previewNextOffer(rules, bank, &previews, 1, rules.board.allMask, rules.casesPerRound[0], 0, preview);
+            total += preview.mean;
+        }
+        sinkValue = total;
+    }));
+
+    // Complete games through the session state machine: open cases in
+    // order, refuse every offer and keep the case at a final swap
+    using Session = BasicGameSession<Variant>;
+    using Phase = typename Session::Phase;
+    const ComputerPlayer& advisor = ComputerPlayer::shared();
+    constexpr long long SessionGames = 20000;
+    long long commands = 0;
+    auto play = [&]() {
+        Session session;
+        char buffer[256];
+        char line[32];
+        std::uint64_t seedState = 7;
+        std::size_t replied = 0;
+        commands = 0;
+        for (long long game = 0; game < SessionGames; game++) {
+            auto send = [&](std::string_view command) {
+                TextWriter reply(buffer, sizeof(buffer));
+                session.handle(rules, bank, command, reply, advisor, seedState);
+                replied += reply.size();
+                commands++;
+            };
+            send("NEW");
+            send("CASE 1");
+            int next = 2;
+            for (Phase phase; (phase = session.currentPhase()) != Phase::Finished;) {
+                if (phase == Phase::OpenCases) {
+                    TextWriter command(line, sizeof(line));
+                    command.put("OPEN ").putInt(next++);
+                    send(command.view());
+                } else if (phase == Phase::Decide) {
+                    send("NODEAL");
+                } else {
+                    send("KEEP");
+                }
+            }
+        }
+        sinkSize = replied;
+    };
+    play();
+    report(name, "session command", nanosecondsPerOperation(commands, play));
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    std::vector<std::string_view> selected(argv + 1, argv + argc);
+    for (std::string_view name : selected) {
+        if (!withVariant(name, [](auto) {})) {
+            std::cout << "Unknown variant: " << name << std::endl;
+            return 1;
+        }
+    }
+
+    out.put("variant     benchmark             time\n");
+    benchDecision();
+    benchArchive();
+    forEachVariant([&](auto variant) {
+        using Variant = decltype(variant);
+        if (!selected.empty() && std::find(selected.begin(), selected.end(), Variant::Name) == selected.end()) return;
+        benchVariant<Variant>(BuiltinRules<Variant>);
+    });
+    return 0;
+}
@@ -0,0 +1,70 @@
+#ifndef DEALMASTER_BIT_OPS_H
+#define DEALMASTER_BIT_OPS_H
+
+#include <cstdint>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+// Bit counts of prize masks and table indices: the builtins under GCC and
+// Clang, the intrinsics under MSVC, and plain loops anywhere else.
+
+// Set bits of `value`. On x86 without -mpopcnt the GCC/Clang builtin is a
+// library call, so the inline bit-twiddling version is used there instead.
+inline int popcount32(std::uint32_t value) {
+#if (defined(__GNUC__) || defined(__clang__)) && (defined(__POPCNT__) || !(defined(__x86_64__) || defined(__i386__)))
+    return __builtin_popcount(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return static_cast<int>(__popcnt(value));
+#else
+    value = value - ((value >> 1) & 0x55555555u);
+    value = (value & 0x33333333u) + ((value >> 2) & 0x33333333u);
+    return static_cast<int>((((value + (value >> 4)) & 0x0F0F0F0Fu) * 0x01010101u) >> 24);
+#endif
+}
+
+// Index of the lowest set bit of `value`, which must not be 0
+inline int countTrailingZeros(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanForward64(&index, value);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanForward(&index, static_cast<unsigned long>(value))) return static_cast<int>(index);
+    _BitScanForward(&index, static_cast<unsigned long>(value >> 32));
+    return static_cast<int>(index) + 32;
+#else
+    int index = 0;
+    while (!(value & 1u)) {
+        value >>= 1;
+        index++;
+    }
+    return index;
+#endif
+}
+
+// Index of the highest set bit of `value`, which must not be 0
+inline int highestBit(std::uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+    unsigned long index;
+    _BitScanReverse64(&index, value);
+    return static_cast<int>(index);
+#elif defined(_MSC_VER)
+    unsigned long index;
+    if (_BitScanReverse(&index, static_cast<unsigned long>(value >> 32))) return static_cast<int>(index) + 32;
+    _BitScanReverse(&index, static_cast<unsigned long>(value));
+    return static_cast<int>(index);
+#else
+    int index = 0;
+    while (value >>= 1) index++;
+    return index;
+#endif
+}
+
+#endif // DEALMASTER_BIT_OPS_H
@@ -0,0 +1,226 @@
+#ifndef DEALMASTER_COMPUTER_PLAYER_H
+#define DEALMASTER_COMPUTER_PLAYER_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+#include "game_variants.h"
+#include "prize_ranks.h"
+#include "replay_log.h"
+
+// A plain list of prize values in the shape of BasicPrizeRanks, for
+// callers that have no board (the load generator, tests). Every query is a
+// linear scan.
+class PrizeList {
+private:
+    const std::vector<double>& prizes;
+
+public:
+    explicit PrizeList(const std::vector<double>& values) : prizes(values) {}
+
+    int count() const {
+        return static_cast<int>(prizes.size());
+    }
+
+    double mean() const {
+        if (prizes.empty()) return 0.0;
+        double sum = 0.0;
+        for (double prize : prizes) sum += prize;
+        return sum / prizes.size();
+    }
+
+    int countAbove(double amount) const {
+        return static_cast<int>(std::count_if(prizes.begin(), prizes.end(), [&](double prize) { return prize > amount; }));
+    }
+
+    double median() const {
+        if (prizes.empty()) return 0.0;
+        thread_local std::vector<double> sorted;
+        sorted.assign(prizes.begin(), prizes.end());
+        std::sort(sorted.begin(), sorted.end());
+        std::size_t size = sorted.size();
+        return (sorted[(size - 1) / 2] + sorted[size / 2]) / 2;
+    }
+
+    template <class Visit>
+    void forEach(const Visit& visit) const {
+        for (double prize : prizes) visit(prize);
+    }
+};
+
+// Advanced AI Computer Player. It holds no state: every decision is a
+// pure function of its arguments, so a single shared instance serves all
+// games and threads. Decisions take the prizes in play either as the
+// order statistics of a board (BasicPrizeRanks, what the game, simulator
+// and sessions keep) or as a plain list of values.
+class ComputerPlayer {
+private:
+    // Calculate standard deviation for risk assessment
+    template <class Prizes>
+    double calculateStandardDeviation(const Prizes& prizes) const {
+        if (prizes.count() <= 1) return 0.0;
+        
+        double mean = prizes.mean();
+        double variance = 0.0;
+        
+        prizes.forEach([&](double prize) { variance += (prize - mean) * (prize - mean); });
+        variance /= prizes.count();
+        
+        return std::sqrt(variance);
+    }
+    
+    // Calculate risk-adjusted decision factor
+    template <class Prizes>
+    double calculateRiskFactor(const Prizes& prizes, double bankOffer) const {
+        double expectedValue = prizes.mean();
+        double stdDev = calculateStandardDeviation(prizes);
+        
+        // Risk adjustment based on variance
+        double riskAdjustment = stdDev / (expectedValue + 1.0);
+        
+        // Calculate probability of getting better than bank offer
+        double probBetter = (double)prizes.countAbove(bankOffer) / prizes.count();
+        
+        return probBetter - riskAdjustment * 0.3; // Conservative approach
+    }
+    
+    template <class Prizes>
+    bool decide(const Prizes& prizes, double bankOffer, int casesRemaining) const {
+        if (prizes.count() == 0) return true;
+        
+        double expectedValue = prizes.mean();
+        
+        // Early game strategy (more cases remaining)
+        if (casesRemaining > 10) {
+            return bankOffer >= expectedValue * 0.9; // Conservative early on
+        }
+        // Mid game strategy
+        else if (casesRemaining > 5) {
+            return bankOffer >= expectedValue * 0.85; // More aggressive
+        }
+        // End game strategy
+        else {
+            double riskFactor = calculateRiskFactor(prizes, bankOffer);
+            return riskFactor < 0.4 || bankOffer >= expectedValue * 0.8;
+        }
+    }
+    
+    template <class Writer, class Prizes>
+    void adviseSwap(Writer& out, const Prizes& prizes) const {
+        out.put("\n=== AI ADVISOR ===\n");
+        if (prizes.count() == 0) return;
+        
+        double share = 100.0 / prizes.count();
+        prizes.forEach([&](double prize) {
+            out.put("Your case holds $").putFixed(prize, 2).put(": ").putFixed(share, 1).put("%\n");
+        });
+        out.put("Expected Value (keep or swap): $").putFixed(prizes.mean(), 2).put('\n');
+        out.put("RECOMMENDATION: Either way! Swapping does not change your odds.\n");
+    }
+    
+    template <class Writer, class Prizes>
+    void advise(Writer& out, const Prizes& prizes, double bankOffer, int casesRemaining, bool swapAfter) const {
+        if (prizes.count() == 0) {
+            out.put("Accept the deal!");
+            return;
+        }
+        
+        double expectedValue = prizes.mean();
+        double stdDev = calculateStandardDeviation(prizes);
+        
+        out.put("\n=== AI ADVISOR ===\n");
+        out.put("Expected Value: $").putFixed(expectedValue, 2).put('\n');
+        out.put("Median Prize: $").putFixed(prizes.median(), 2).put('\n');
+        out.put("Bank Offer: $").putFixed(bankOffer, 2).put('\n');
+        out.put("Offer vs Expected: ").putFixed(bankOffer / expectedValue * 100, 1).put("%\n");
+        out.put("Risk Level: ").putFixed(stdDev / expectedValue * 100, 1).put("%\n");
+        out.put("Prizes Above Offer: ").putInt(prizes.countAbove(bankOffer)).put(" of ").putInt(prizes.count()).put('\n');
+        
+        if (decide(prizes, bankOffer, casesRemaining)) {
+            out.put("RECOMMENDATION: DEAL! The offer is favorable.\n");
+        } else {
+            out.put("RECOMMENDATION: NO DEAL! You can likely do better.\n");
+        }
+        if (swapAfter && casesRemaining == 2) {
+            out.put("After NO DEAL you may swap cases; the odds stay 50/50 either way.\n");
+        }
+    }
+
+public:
+    // The one instance used by every game
+    static const ComputerPlayer& shared() {
+        static const ComputerPlayer instance{};
+        return instance;
+    }
+    
+    // Make optimal decision for computer player
+    template <int N>
+    bool shouldAcceptDeal(const BasicPrizeRanks<N>& prizes, double bankOffer, int casesRemaining) const {
+        return decide(prizes, bankOffer, casesRemaining);
+    }
+    
+    bool shouldAcceptDeal(const std::vector<double>& remainingPrizes, double bankOffer, int casesRemaining) const {
+        return decide(PrizeList(remainingPrizes), bankOffer, casesRemaining);
+    }
+    
+    // Final swap of the player's case for the last other unopened case.
+    // Cases are opened blind, so given the prizes left the player's case is
+    // equally likely to hold any of them, and so is the case on offer:
+    // keeping and swapping have exactly the same distribution. With nothing
+    // to gain the computer keeps.
+    template <class Prizes>
+    bool shouldSwap(const Prizes& prizes) const {
+        (void)prizes;
+        return false;
+    }
+    
+    // Exact odds of the final swap for the human player, written to `out`
+    // (a FrameBuffer or TextWriter)
+    template <class Writer, int N>
+    void writeSwapAdvice(Writer& out, const BasicPrizeRanks<N>& prizes) const {
+        adviseSwap(out, prizes);
+    }
+    
+    template <class Writer>
+    void writeSwapAdvice(Writer& out, const std::vector<double>& remainingPrizes) const {
+        adviseSwap(out, PrizeList(remainingPrizes));
+    }
+    
+    // Provide advice to human player; `swapAfter` notes that refusing the
+    // final offer leads to a case swap
+    template <class Writer, int N>
+    void writeAdvice(Writer& out, const BasicPrizeRanks<N>& prizes, double bankOffer, int casesRemaining,
+                     bool swapAfter = false) const {
+        advise(out, prizes, bankOffer, casesRemaining, swapAfter);
+    }
+    
+    template <class Writer>
+    void writeAdvice(Writer& out, const std::vector<double>& remainingPrizes, double bankOffer, int casesRemaining,
+                     bool swapAfter = false) const {
+        advise(out, PrizeList(remainingPrizes), bankOffer, casesRemaining, swapAfter);
+    }
+    
+    // Select cases to open (for computer player) among the N cases not in
+    // `opened` (a bit per case), shuffled with `seed`. Writes
+    // up to `numToOpen` case indices to `selected` and returns how many;
+    // `selected` needs room for N.
+    template <int N>
+    int selectCasesToOpen(CaseMask<N> opened, int numToOpen, std::uint64_t seed, int* selected) const {
+        int availableCases[N];
+        int available = 0;
+        for (int i = 0; i < N; i++) {
+            if (!((opened >> i) & 1u)) {
+                availableCases[available++] = i;
+            }
+        }
+        
+        replay::shuffleWithSeed(seed, availableCases, available);
+        
+        int count = std::min(numToOpen, available);
+        std::copy(availableCases, availableCases + count, selected);
+        return count;
+    }
+};
+
+#endif // DEALMASTER_COMPUTER_PLAYER_H
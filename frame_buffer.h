@@ -0,0 +1,169 @@
+#ifndef DEALMASTER_FRAME_BUFFER_H
+#define DEALMASTER_FRAME_BUFFER_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+#include "money.h"
+
+// Console render layer. Each frame (board, prize list, offer banner, ...)
+// is composed into a fixed buffer and handed to the OS in a single write()
+// when the game reaches a prompt, instead of flushing std::cout per line.
+// A buffer opened on a negative descriptor drops every frame; on Muted the
+// game also skips rendering optional output (board, advice), on Discard it
+// renders everything as if writing to a terminal.
+class FrameBuffer {
+public:
+    static constexpr std::size_t Capacity = 16 * 1024;
+    static constexpr int Muted = -1;
+    static constexpr int Discard = -2;
+
+private:
+    char buffer[Capacity];
+    std::size_t length;
+    int fd;
+
+    // Make room for at least `needed` bytes, spilling the frame early if a
+    // single frame outgrows the buffer
+    void reserve(std::size_t needed) {
+        if (length + needed > Capacity) {
+            flush();
+        }
+    }
+
+    void writeAll(const char* data, std::size_t size) {
+        if (fd < 0) return;
+        while (size > 0) {
+#ifdef _WIN32
+            int written = _write(fd, data, static_cast<unsigned int>(size));
+#else
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0 && errno == EINTR) continue;
+#endif
+            if (written <= 0) return; // Output closed; drop the frame
+            data += written;
+            size -= static_cast<std::size_t>(written);
+        }
+    }
+
+public:
+    explicit FrameBuffer(int fileDescriptor = 1) : length(0), fd(fileDescriptor) {}
+
+    FrameBuffer(const FrameBuffer&) = delete;
+    FrameBuffer& operator=(const FrameBuffer&) = delete;
+
+    ~FrameBuffer() {
+        flush();
+    }
+
+    FrameBuffer& put(std::string_view text) {
+        if (text.size() > Capacity) {
+            flush();
+            writeAll(text.data(), text.size());
+            return *this;
+        }
+        reserve(text.size());
+        std::memcpy(buffer + length, text.data(), text.size());
+        length += text.size();
+        return *this;
+    }
+
+    FrameBuffer& put(char ch) {
+        reserve(1);
+        buffer[length++] = ch;
+        return *this;
+    }
+
+    // Append `count` copies of `ch` (replaces std::string(50, '=') rulers)
+    FrameBuffer& repeat(char ch, std::size_t count) {
+        if (count > Capacity) count = Capacity;
+        reserve(count);
+        std::memset(buffer + length, ch, count);
+        length += count;
+        return *this;
+    }
+
+    // Integer right-aligned in a field of `width` characters (like std::setw)
+    FrameBuffer& putInt(long long value, int width = 0) {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        std::size_t size = static_cast<std::size_t>(result.ptr - digits);
+        if (width > 0 && size < static_cast<std::size_t>(width)) {
+            repeat(' ', static_cast<std::size_t>(width) - size);
+        }
+        return put(std::string_view(digits, size));
+    }
+
+    FrameBuffer& putUnsigned(unsigned long long value) {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        return put(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+    }
+
+    // Fixed-point decimal, equivalent to std::fixed << std::setprecision(precision)
+    FrameBuffer& putFixed(double value, int precision) {
+        char digits[352]; // Enough for any double in fixed notation
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value,
+                                                    std::chars_format::fixed, precision);
+        if (result.ec != std::errc()) return put('?');
+        return put(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+    }
+
+    // Dollar amount, e.g. "$1234.50"
+    FrameBuffer& putMoney(double value, int precision = 2) {
+        put('$');
+        return putFixed(value, precision);
+    }
+
+    // Amount in cents as exact decimal dollars, e.g. "1234.50"
+    FrameBuffer& putCents(Cents amount) {
+        if (amount < 0) {
+            put('-');
+            amount = -amount;
+        }
+        putInt(amount / 100).put('.');
+        return put(static_cast<char>('0' + amount / 10 % 10)).put(static_cast<char>('0' + amount % 10));
+    }
+
+    // Dollar amount in cents, e.g. "$1234.50", or to the dollar at precision 0
+    FrameBuffer& putMoney(Cents amount, int precision = 2) {
+        put('$');
+        if (precision != 0) return putCents(amount);
+        return putInt(amount >= 0 ? (amount + 50) / 100 : -((50 - amount) / 100));
+    }
+
+    FrameBuffer& newline() {
+        return put('\n');
+    }
+
+    // Hand the composed frame to the OS in a single write()
+    void flush() {
+        if (length == 0) return;
+        writeAll(buffer, length);
+        length = 0;
+    }
+
+    // Drop the pending frame without writing it
+    void discard() {
+        length = 0;
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+    bool muted() const {
+        return fd == Muted;
+    }
+};
+
+#endif // DEALMASTER_FRAME_BUFFER_H
@@ -0,0 +1,28 @@
+#ifndef DEALMASTER_GAME_RULES_H
+#define DEALMASTER_GAME_RULES_H
+
+// Rules shared by every front-end (console, batch, server)
+
+// Prize values of the standard 26-case board
+inline constexpr double STANDARD_PRIZES[26] = {
+    0.01, 1.0, 5.0, 10.0, 25.0, 50.0, 75.0, 100.0, 200.0, 300.0,
+    400.0, 500.0, 750.0, 1000.0, 5000.0, 10000.0, 25000.0, 50000.0,
+    75000.0, 100000.0, 200000.0, 300000.0, 400000.0, 500000.0, 750000.0, 1000000.0
+};
+
+// Number of cases opened in each round before the bank calls
+inline constexpr int CASES_PER_ROUND[9] = {6, 5, 4, 3, 2, 1, 1, 1, 1};
+
+// Default offer curve: OFFER_BASE + round * OFFER_STEP, capped at OFFER_CAP
+inline constexpr double OFFER_BASE = 0.1;
+inline constexpr double OFFER_STEP = 0.05;
+inline constexpr double OFFER_CAP = 0.9;
+
+// Share of the average remaining prize that the bank offers in `round`
+inline constexpr double bankOfferPercentage(int round) {
+    double offerPercentage = OFFER_BASE + (round * OFFER_STEP);
+    if (offerPercentage > OFFER_CAP) offerPercentage = OFFER_CAP;
+    return offerPercentage;
+}
+
+#endif // DEALMASTER_GAME_RULES_H
@@ -0,0 +1,600 @@
+#ifndef DEALMASTER_GAME_SERVER_H
+#define DEALMASTER_GAME_SERVER_H
+
+#if defined(__linux__)
+
+#include <atomic>
+#include <charconv>
+#include <chrono>
+#include <csignal>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <cerrno>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "bank_model.h"
+#include "computer_player.h"
+#include "game_session.h"
+#include "metrics.h"
+#include "offer_preview.h"
+#include "slab_pool.h"
+#include "text_writer.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+// Multi-session game server.
+//
+// Each shard is a single-threaded epoll reactor that keeps its
+// connections in a SlabPool; a connection record is the socket, the tail
+// of an unfinished command and its GameSession, 112 bytes in all. Reads
+// and replies go through buffers owned by the shard, and only a client
+// that stops reading borrows an output backlog. Shards share the listening
+// socket (EPOLLEXCLUSIVE), so a connection stays on the shard that
+// accepted it. The shards share only two things: the count of open
+// sessions, so the session limit holds for the server however unevenly
+// the accepts fall, and the lock-free cache of next-offer previews, which
+// every session of the server hits (the opening round's is the same for
+// all). Sessions speak the line protocol of GameSession.
+
+struct ServerOptions {
+    std::string endpoint;            // "unix:/path", "tcp:port" or "tcp:host:port"
+    int threads = 1;
+    std::size_t maxSessions = 100000;
+    std::size_t previewCacheBytes = std::size_t(16) << 20;    // 0 turns the cache off
+};
+
+// Totals reported when the server stops
+struct ServerCounters {
+    std::uint64_t accepted = 0;
+    std::uint64_t rejected = 0;
+    std::uint64_t commands = 0;
+    std::uint64_t peakSessions = 0;      // Most sessions open at once, over all shards
+};
+
+// Sessions open across all shards, against the server's limit
+class SessionLimit {
+private:
+    std::size_t limit;
+    std::atomic<std::size_t> open{0};
+    std::atomic<std::size_t> peak{0};
+
+public:
+    explicit SessionLimit(std::size_t maxSessions) : limit(maxSessions) {}
+
+    // Count a new session; false if the server is full
+    bool claim() {
+        std::size_t count = open.load(std::memory_order_relaxed);
+        do {
+            if (count >= limit) return false;
+        } while (!open.compare_exchange_weak(count, count + 1, std::memory_order_relaxed));
+        count++;
+        std::size_t top = peak.load(std::memory_order_relaxed);
+        while (count > top && !peak.compare_exchange_weak(top, count, std::memory_order_relaxed)) {
+        }
+        return true;
+    }
+
+    void release() {
+        open.fetch_sub(1, std::memory_order_relaxed);
+    }
+
+    std::size_t current() const {
+        return open.load(std::memory_order_relaxed);
+    }
+
+    std::size_t highest() const {
+        return peak.load(std::memory_order_relaxed);
+    }
+};
+
+namespace server_detail {
+
+inline std::atomic<bool>& stopFlag() {
+    static std::atomic<bool> flag(false);
+    return flag;
+}
+
+inline void onStopSignal(int) {
+    stopFlag().store(true);
+}
+
+} // namespace server_detail
+
+template <class Variant>
+class ServerShard {
+public:
+    static constexpr std::size_t LineCapacity = 44;    // Longest partial command kept between reads
+    static constexpr std::size_t ReadChunk = 4096;
+    static constexpr std::size_t OutputChunk = 8192;
+    static constexpr std::size_t MaxReply = 160;       // Longest single reply line
+    static constexpr std::uint32_t NoBacklog = 0xFFFFFFFFu;
+
+private:
+    using Phase = typename BasicGameSession<Variant>::Phase;
+
+    // What a connection keeps between events. Read and write buffers belong
+    // to the shard; a connection only holds the tail of an unfinished
+    // command line, and borrows a Backlog while its client is not reading.
+    struct Connection {
+        int fd = -1;
+        std::uint32_t backlog = NoBacklog;   // Index into backlogs
+        std::uint8_t carryLength = 0;
+        bool discarding = false;             // Skipping the rest of an over-long line
+        bool waitingForWrite = false;        // Reading paused until the backlog drains
+        char carry[LineCapacity];
+        BasicGameSession<Variant> game;
+    };
+
+    static_assert(sizeof(Connection) <= 128, "Connection should stay within two cache lines");
+
+    // Replies a slow client has not accepted yet and the input that arrived
+    // behind them. Recycled backlogs keep their string capacity.
+    struct Backlog {
+        std::string output;
+        std::size_t sent = 0;
+        std::string input;
+    };
+
+    int listenFd;
+    int epollFd;
+    SlabPool<Connection> connections;
+    std::vector<Backlog> backlogs;
+    std::vector<std::uint32_t> freeBacklogs;
+    const BasicGameRules<Variant::Cases>& rules;
+    const BasicBankModel<Variant::Cases>& bank;
+    const ComputerPlayer& advisor;
+    SessionLimit& sessions;
+    OfferPreviewCache* previews;
+    std::uint64_t seedState;
+    ServerCounters counters;
+
+    char input[LineCapacity + ReadChunk];
+    char output[OutputChunk];
+    std::size_t outputLength;
+    std::string replayInput;    // Backlogged input being served after a drain
+
+    void watch(int fd, std::uint32_t events, std::uint64_t key, int op) {
+        epoll_event event;
+        event.events = events;
+        event.data.u64 = key;
+        epoll_ctl(epollFd, op, fd, &event);
+    }
+
+    bool backlogged(const Connection& conn) const {
+        return conn.backlog != NoBacklog && !backlogs[conn.backlog].output.empty();
+    }
+
+    Backlog& backlogFor(Connection& conn) {
+        if (conn.backlog == NoBacklog) {
+            if (freeBacklogs.empty()) {
+                conn.backlog = static_cast<std::uint32_t>(backlogs.size());
+                backlogs.emplace_back();
+            } else {
+                conn.backlog = freeBacklogs.back();
+                freeBacklogs.pop_back();
+            }
+        }
+        return backlogs[conn.backlog];
+    }
+
+    void releaseBacklog(Connection& conn) {
+        if (conn.backlog == NoBacklog) return;
+        Backlog& backlog = backlogs[conn.backlog];
+        backlog.output.clear();
+        backlog.sent = 0;
+        backlog.input.clear();
+        freeBacklogs.push_back(conn.backlog);
+        conn.backlog = NoBacklog;
+    }
+
+    void closeConnection(std::uint32_t index) {
+        Connection& conn = connections[index];
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, conn.fd, nullptr);
+        ::close(conn.fd);
+        releaseBacklog(conn);
+        conn.fd = -1;
+        connections.release(index);
+        sessions.release();
+        if (metrics::enabled()) metrics::bump(metrics::local().sessionsClosed);
+        trace::instant("session closed", "server", "sessions", static_cast<std::int64_t>(sessions.current()));
+    }
+
+    void acceptConnections() {
+        while (true) {
+            int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (fd < 0) {
+                if (errno == EINTR) continue;
+                return; // EAGAIN: another shard took it, or the backlog is empty
+            }
+
+            // Each pool holds the whole server's limit, so a claimed
+            // session always finds a record
+            std::uint32_t index;
+            bool claimed = sessions.claim();
+            if (!claimed || !connections.allocate(index)) {
+                if (claimed) sessions.release();
+                static const char full[] = "ERR server full\n";
+                ssize_t ignored = ::send(fd, full, sizeof(full) - 1, MSG_NOSIGNAL);
+                (void)ignored;
+                ::close(fd);
+                counters.rejected++;
+                continue;
+            }
+
+            int one = 1;
+            setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // Fails harmlessly on Unix sockets
+
+            Connection& conn = connections[index];
+            conn.fd = fd;
+            conn.backlog = NoBacklog;
+            conn.carryLength = 0;
+            conn.discarding = false;
+            conn.waitingForWrite = false;
+            conn.game.reset();
+            watch(fd, EPOLLIN | EPOLLRDHUP, static_cast<std::uint64_t>(index) + 1, EPOLL_CTL_ADD);
+            counters.accepted++;
+            if (metrics::enabled()) metrics::bump(metrics::local().sessionsOpened);
+            trace::instant("session opened", "server", "sessions", static_cast<std::int64_t>(sessions.current()));
+        }
+    }
+
+    // Send the shard output buffer to `conn`; whatever the socket does not
+    // take is parked in the connection's backlog. Returns false on a fatal
+    // socket error.
+    bool sendOutput(Connection& conn) {
+        std::size_t sent = 0;
+        if (!backlogged(conn)) {
+            while (sent < outputLength) {
+                ssize_t result = ::send(conn.fd, output + sent, outputLength - sent, MSG_NOSIGNAL);
+                if (result < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+                    outputLength = 0;
+                    return false;
+                }
+                sent += static_cast<std::size_t>(result);
+            }
+        }
+        if (sent < outputLength) {
+            backlogFor(conn).output.append(output + sent, outputLength - sent);
+        }
+        outputLength = 0;
+        return true;
+    }
+
+    // Count what one command did to its game in this thread's metrics
+    void meter(const BasicGameSession<Variant>& game, Phase before, int round, std::uint64_t started) {
+        metrics::ThreadMetrics& block = metrics::local();
+        metrics::recordLatency(block, metrics::Histogram::Command, metrics::now() - started);
+        Phase after = game.currentPhase();
+        if (after == Phase::Decide && before != Phase::Decide) metrics::bump(block.offers[game.currentRound() - 1]);
+        if (after == Phase::Finished && before != Phase::Finished) {
+            metrics::bump(block.games);
+            // A refused last offer also finishes the game, but moves the round on
+            if (before == Phase::Decide && game.currentRound() == round) metrics::bump(block.deals[round - 1]);
+        }
+    }
+
+    // Run the complete command lines in data[0, length) and send the
+    // replies. If the client stops reading, the unprocessed input is parked
+    // in its backlog; an unfinished last line is carried to the next read.
+    // Returns false on a fatal socket error.
+    bool serve(Connection& conn, const char* data, std::size_t length) {
+        std::size_t position = 0;
+        while (position < length && !conn.game.wantsClose()) {
+            const char* begin = data + position;
+            const char* newline = static_cast<const char*>(std::memchr(begin, '\n', length - position));
+            if (!newline) break;
+
+            if (conn.discarding) {
+                conn.discarding = false;
+                position = static_cast<std::size_t>(newline - data) + 1;
+                continue;
+            }
+            if (OutputChunk - outputLength < MaxReply + 1) {
+                if (!sendOutput(conn)) return false;
+                if (backlogged(conn)) {
+                    backlogFor(conn).input.append(begin, length - position);
+                    return true;
+                }
+            }
+
+            TextWriter reply(output + outputLength, MaxReply);
+            bool metered = metrics::enabled();
+            std::uint64_t started = metered ? metrics::now() : 0;
+            Phase before = conn.game.currentPhase();
+            int round = conn.game.currentRound();
+            conn.game.handle(rules, bank, std::string_view(begin, static_cast<std::size_t>(newline - begin)),
+                             reply, advisor, seedState, previews);
+            if (metered) meter(conn.game, before, round, started);
+            outputLength += reply.size();
+            output[outputLength++] = '\n';
+            counters.commands++;
+            position = static_cast<std::size_t>(newline - data) + 1;
+        }
+
+        std::size_t rest = length - position;
+        if (rest > 0 && !conn.game.wantsClose() && !conn.discarding) {
+            if (rest <= LineCapacity) {
+                std::memcpy(conn.carry, data + position, rest);
+                conn.carryLength = static_cast<std::uint8_t>(rest);
+            } else {
+                // No command is this long: reject it and skip to the next line
+                static const char tooLong[] = "ERR line too long\n";
+                if (OutputChunk - outputLength < sizeof(tooLong) && !sendOutput(conn)) return false;
+                std::memcpy(output + outputLength, tooLong, sizeof(tooLong) - 1);
+                outputLength += sizeof(tooLong) - 1;
+                conn.discarding = true;
+            }
+        }
+        return sendOutput(conn);
+    }
+
+    // Wait for EPOLLOUT while a backlog is pending, otherwise for input
+    void updateInterest(std::uint32_t index, Connection& conn) {
+        bool pending = backlogged(conn);
+        if (!pending) releaseBacklog(conn);
+        if (pending != conn.waitingForWrite) {
+            conn.waitingForWrite = pending;
+            watch(conn.fd, pending ? EPOLLOUT : (EPOLLIN | EPOLLRDHUP),
+                  static_cast<std::uint64_t>(index) + 1, EPOLL_CTL_MOD);
+        }
+    }
+
+    void onReadable(std::uint32_t index) {
+        Connection& conn = connections[index];
+        while (!backlogged(conn)) {
+            std::size_t carried = conn.carryLength;
+            std::memcpy(input, conn.carry, carried);
+            ssize_t received = ::recv(conn.fd, input + carried, ReadChunk, 0);
+            if (received < 0 && errno == EINTR) continue;
+            if (received < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+            if (received <= 0) {
+                closeConnection(index);
+                return;
+            }
+
+            conn.carryLength = 0;
+            if (!serve(conn, input, carried + static_cast<std::size_t>(received))) {
+                closeConnection(index);
+                return;
+            }
+            if (conn.game.wantsClose() && !backlogged(conn)) {
+                closeConnection(index);
+                return;
+            }
+            if (static_cast<std::size_t>(received) < ReadChunk) break; // Drained; epoll is level-triggered
+        }
+        updateInterest(index, conn);
+    }
+
+    void onWritable(std::uint32_t index) {
+        Connection& conn = connections[index];
+        if (conn.backlog != NoBacklog) {
+            Backlog& backlog = backlogs[conn.backlog];
+            while (backlog.sent < backlog.output.size()) {
+                ssize_t sent = ::send(conn.fd, backlog.output.data() + backlog.sent,
+                                      backlog.output.size() - backlog.sent, MSG_NOSIGNAL);
+                if (sent < 0) {
+                    if (errno == EINTR) continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+                    closeConnection(index);
+                    return;
+                }
+                backlog.sent += static_cast<std::size_t>(sent);
+            }
+            backlog.output.clear();
+            backlog.sent = 0;
+            replayInput.swap(backlog.input);
+        }
+
+        if (conn.game.wantsClose()) {
+            closeConnection(index);
+            return;
+        }
+
+        // Drained: serve the commands that were held back
+        bool ok = serve(conn, replayInput.data(), replayInput.size());
+        replayInput.clear();
+        if (!ok || (conn.game.wantsClose() && !backlogged(conn))) {
+            closeConnection(index);
+            return;
+        }
+        updateInterest(index, conn);
+    }
+
+public:
+    ServerShard(int listenSocket, const BasicGameRules<Variant::Cases>& gameRules,
+                const BasicBankModel<Variant::Cases>& bankModel, OfferPreviewCache* previewCache,
+                SessionLimit& sessionLimit, std::size_t maxSessions, std::uint64_t seed)
+        : listenFd(listenSocket), epollFd(-1), connections(maxSessions), rules(gameRules), bank(bankModel),
+          advisor(ComputerPlayer::shared()), sessions(sessionLimit), previews(previewCache), seedState(seed),
+          outputLength(0) {}
+
+    ServerShard(const ServerShard&) = delete;
+    ServerShard& operator=(const ServerShard&) = delete;
+
+    ~ServerShard() {
+        for (std::size_t i = 0; i < connections.reserved(); i++) {
+            Connection& conn = connections[static_cast<std::uint32_t>(i)];
+            if (conn.fd >= 0) ::close(conn.fd);
+        }
+        if (epollFd >= 0) ::close(epollFd);
+    }
+
+    // Event loop; returns when the stop flag is raised. `shard` labels the
+    // thread in traces.
+    void run(int shard) {
+        trace::nameThread("shard " + std::to_string(shard));
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) return;
+        watch(listenFd, EPOLLIN | EPOLLEXCLUSIVE, 0, EPOLL_CTL_ADD);
+
+        epoll_event events[256];
+        while (!server_detail::stopFlag().load(std::memory_order_relaxed)) {
+            int ready = epoll_wait(epollFd, events, 256, 250);
+            if (ready <= 0) continue;
+            trace::Span span("events", "server", "ready", ready);
+            for (int i = 0; i < ready; i++) {
+                std::uint64_t key = events[i].data.u64;
+                if (key == 0) {
+                    acceptConnections();
+                    continue;
+                }
+                std::uint32_t index = static_cast<std::uint32_t>(key - 1);
+                if (connections[index].fd < 0) continue; // Closed earlier in this batch
+                if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                    closeConnection(index);
+                } else if (events[i].events & EPOLLOUT) {
+                    onWritable(index);
+                } else {
+                    onReadable(index);
+                }
+            }
+        }
+    }
+
+    const ServerCounters& stats() const {
+        return counters;
+    }
+};
+
+class GameServer {
+private:
+    ServerOptions options;
+    int listenFd;
+    std::string unixPath;
+
+    static bool parsePort(std::string_view text, std::uint16_t& port) {
+        unsigned value = 0;
+        std::from_chars_result result = std::from_chars(text.data(), text.data() + text.size(), value);
+        if (result.ec != std::errc() || result.ptr != text.data() + text.size() || value > 65535) return false;
+        port = static_cast<std::uint16_t>(value);
+        return true;
+    }
+
+    bool listenUnix(const std::string& path) {
+        sockaddr_un address;
+        std::memset(&address, 0, sizeof(address));
+        if (path.size() >= sizeof(address.sun_path)) return false;
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+
+        listenFd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) return false;
+        ::unlink(path.c_str());
+        if (::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0) return false;
+        unixPath = path;
+        return true;
+    }
+
+    bool listenTcp(std::string_view hostPort) {
+        std::string host = "0.0.0.0";
+        std::string_view portText = hostPort;
+        std::string_view::size_type colon = hostPort.rfind(':');
+        if (colon != std::string_view::npos) {
+            host = std::string(hostPort.substr(0, colon));
+            portText = hostPort.substr(colon + 1);
+        }
+
+        sockaddr_in address;
+        std::memset(&address, 0, sizeof(address));
+        address.sin_family = AF_INET;
+        std::uint16_t port;
+        if (!parsePort(portText, port) || ::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) {
+            return false;
+        }
+        address.sin_port = htons(port);
+
+        listenFd = ::socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0) return false;
+        int one = 1;
+        setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        return ::bind(listenFd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == 0;
+    }
+
+public:
+    explicit GameServer(const ServerOptions& serverOptions) : options(serverOptions), listenFd(-1) {}
+
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    ~GameServer() {
+        if (listenFd >= 0) ::close(listenFd);
+        if (!unixPath.empty()) ::unlink(unixPath.c_str());
+    }
+
+    // Bind and listen on the configured endpoint
+    bool open() {
+        std::string_view endpoint = options.endpoint;
+        bool bound = false;
+        if (endpoint.substr(0, 5) == "unix:") {
+            bound = listenUnix(std::string(endpoint.substr(5)));
+        } else if (endpoint.substr(0, 4) == "tcp:") {
+            bound = listenTcp(endpoint.substr(4));
+        }
+        return bound && ::listen(listenFd, SOMAXCONN) == 0;
+    }
+
+    // Serve games of `Variant` under `rules`, priced by `bank`, until
+    // SIGINT/SIGTERM; returns the combined counters. The rules must outlive
+    // the call.
+    template <class Variant>
+    ServerCounters run(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank) {
+        server_detail::stopFlag().store(false);
+        std::signal(SIGINT, server_detail::onStopSignal);
+        std::signal(SIGTERM, server_detail::onStopSignal);
+        std::signal(SIGPIPE, SIG_IGN);
+
+        int threads = options.threads > 0 ? options.threads : 1;
+        SessionLimit sessions(options.maxSessions);
+        std::uint64_t seed = static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+
+        std::unique_ptr<OfferPreviewCache> previews;
+        if (options.previewCacheBytes > 0) {
+            previews = std::make_unique<OfferPreviewCache>(options.previewCacheBytes, Replacement::KeepCostly,
+                                                           metrics::Cache::Preview);
+        }
+        std::vector<std::unique_ptr<ServerShard<Variant>>> shards;
+        for (int i = 0; i < threads; i++) {
+            shards.push_back(std::make_unique<ServerShard<Variant>>(listenFd, rules, bank, previews.get(), sessions,
+                                                                   options.maxSessions, replay::splitMix64(seed)));
+        }
+
+        std::vector<std::thread> workers;
+        for (int i = 1; i < threads; i++) {
+            workers.emplace_back([&shards, i]() { shards[i]->run(i); });
+        }
+        shards[0]->run(0);
+        for (std::thread& worker : workers) worker.join();
+
+        trace::Span span("merge counters", "server", "shards", threads);
+        ServerCounters total;
+        for (const std::unique_ptr<ServerShard<Variant>>& shard : shards) {
+            const ServerCounters& counters = shard->stats();
+            total.accepted += counters.accepted;
+            total.rejected += counters.rejected;
+            total.commands += counters.commands;
+        }
+        total.peakSessions = sessions.highest();
+        return total;
+    }
+};
+
+#endif // __linux__
+
+#endif // DEALMASTER_GAME_SERVER_H
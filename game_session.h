@@ -0,0 +1,371 @@
+#ifndef DEALMASTER_GAME_SESSION_H
+#define DEALMASTER_GAME_SESSION_H
+
+#include <algorithm>
+#include <charconv>
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "bank_model.h"
+#include "computer_player.h"
+#include "game_variants.h"
+#include "input_parser.h"
+#include "metrics.h"
+#include "money.h"
+#include "offer_preview.h"
+#include "prize_ranks.h"
+#include "replay_log.h"
+#include "text_writer.h"
+#include "variant_rules.h"
+
+// Push-driven game for hosted play. Unlike DealOrNoDealGame, which pulls
+// answers from an InputSource, a GameSession is advanced one command line
+// at a time and answers each command with exactly one reply line, so many
+// sessions can be multiplexed on one thread.
+//
+// Line protocol (commands are case-insensitive; N is the variant's case count):
+//   NEW [seed]   start a game            -> OK NEW CHOOSE 1-N
+//   CASE n       pick your lucky case    -> OK CASE n ROUND 1 OPEN 6
+//   OPEN n       open case n             -> OK OPENED n <value> LEFT k
+//                                           OK OPENED n <value> OFFER <amount> ROUND r
+//                                           OK OPENED n <value> FINAL <amount>
+//   DEAL         accept the offer        -> OK DEAL <amount> HELD <value>
+//   NODEAL       reject the offer        -> OK NODEAL ROUND r OPEN k
+//                                           OK NODEAL FINAL <amount>
+//                                           OK NODEAL SWAP n     (variants with a final swap)
+//   SWAP | KEEP  final swap for case n   -> OK SWAP|KEEP FINAL <amount>
+//   ADVICE       ask the CPU advisor     -> OK ADVICE DEAL|NODEAL EV <ev> OFFER <amount>
+//                                           OK ADVICE SWAP|KEEP EV <ev>
+//   PREVIEW      spread of the next offer -> OK PREVIEW ROUND r WAYS n LOW <a> MEDIAN <a> MEAN <a> HIGH <a>
+//                                           ... BEATS <p>   (deciding: chance it beats the offer made)
+//   STATE        describe the game       -> OK STATE <phase> ROUND r REMAINING k
+//   QUIT         end the connection      -> OK BYE
+// Errors are reported as "ERR <reason>" and leave the game unchanged.
+//
+// The state is a plain, trivially copyable record that fits in one cache
+// line: cases hold indices into the shared prize board of the rules,
+// opened cases are a bit mask, and the advisor is the shared stateless
+// ComputerPlayer. The rules (and the preview cache, when sessions share
+// one) are passed to each call rather than stored, so a session is the
+// same size whichever rules it plays under.
+template <class Variant>
+class BasicGameSession {
+public:
+    static constexpr int Cases = Variant::Cases;
+    using Mask = CaseMask<Cases>;
+    using Rules = BasicGameRules<Cases>;
+    using BankModel = BasicBankModel<Cases>;
+
+    enum class Phase : std::uint8_t {
+        Idle,
+        ChooseCase,
+        OpenCases,
+        Decide,
+        Finished,
+        Swap
+    };
+
+private:
+    Cents remainingSum;
+    Cents offer;
+    Mask openedMask;
+    std::uint8_t casePrize[Cases];  // Index into the rules' prize board
+    Phase phase;
+    bool closing;
+    std::int8_t playerCase;
+    std::uint8_t round;
+    std::uint8_t picksLeft;
+    std::uint8_t remainingCount;
+
+    Cents caseCents(const Rules& rules, int caseIndex) const {
+        return rules.board.cents[casePrize[caseIndex]];
+    }
+
+    bool isOpened(int caseIndex) const {
+        return (openedMask >> caseIndex) & 1u;
+    }
+
+    static bool matches(std::string_view word, std::string_view command) {
+        if (word.size() != command.size()) return false;
+        for (std::size_t i = 0; i < word.size(); i++) {
+            char ch = word[i];
+            if (ch >= 'a' && ch <= 'z') ch = static_cast<char>(ch - 'a' + 'A');
+            if (ch != command[i]) return false;
+        }
+        return true;
+    }
+
+    static const char* phaseName(Phase value) {
+        switch (value) {
+            case Phase::Idle:       return "IDLE";
+            case Phase::ChooseCase: return "CHOOSE";
+            case Phase::OpenCases:  return "OPEN";
+            case Phase::Decide:     return "DECIDE";
+            case Phase::Finished:   return "FINISHED";
+            case Phase::Swap:       return "SWAP";
+        }
+        return "?";
+    }
+
+    void startRound(const Rules& rules, TextWriter& reply) {
+        int picks = rules.casesPerRound[round - 1];
+        if (picks > remainingCount - 1) picks = remainingCount - 1;
+        picksLeft = static_cast<std::uint8_t>(picks);
+        phase = Phase::OpenCases;
+        reply.put("ROUND ").putInt(round).put(" OPEN ").putInt(picksLeft);
+    }
+
+    void finish(const Rules& rules, TextWriter& reply) {
+        phase = Phase::Finished;
+        reply.put("FINAL ").putCents(caseCents(rules, playerCase));
+    }
+
+    // Board indices of the unopened prizes, including the player's case
+    Mask remainingPrizeMask() const {
+        Mask mask = 0;
+        for (int i = 0; i < Cases; i++) {
+            if (!isOpened(i)) mask = static_cast<Mask>(mask | (1u << casePrize[i]));
+        }
+        return mask;
+    }
+
+    void onNew(const Rules& rules, std::string_view argument, TextWriter& reply, std::uint64_t& seedState) {
+        std::uint64_t seed;
+        if (argument.empty()) {
+            seed = replay::splitMix64(seedState);
+        } else {
+            std::from_chars_result result = std::from_chars(argument.data(), argument.data() + argument.size(), seed);
+            if (result.ec != std::errc() || result.ptr != argument.data() + argument.size()) {
+                reply.put("ERR bad seed");
+                return;
+            }
+        }
+        start(rules, seed);
+        reply.put("OK NEW CHOOSE 1-").putInt(Cases);
+    }
+
+    void onCase(const Rules& rules, std::string_view argument, TextWriter& reply) {
+        if (phase != Phase::ChooseCase) {
+            reply.put("ERR not choosing a case");
+            return;
+        }
+        ParseResult choice = parseInt(argument, 1, Cases);
+        if (!choice.ok()) {
+            reply.put("ERR ").put(describeParseError(choice.error));
+            return;
+        }
+        playerCase = static_cast<std::int8_t>(choice.value - 1);
+        round = 1;
+        reply.put("OK CASE ").putInt(choice.value).put(' ');
+        startRound(rules, reply);
+    }
+
+    void onOpen(const Rules& rules, const BankModel& bank, std::string_view argument, TextWriter& reply) {
+        if (phase != Phase::OpenCases) {
+            reply.put("ERR not opening cases");
+            return;
+        }
+        ParseResult choice = parseInt(argument, 1, Cases);
+        if (!choice.ok()) {
+            reply.put("ERR ").put(describeParseError(choice.error));
+            return;
+        }
+        int caseIndex = choice.value - 1;
+        if (caseIndex == playerCase) {
+            reply.put("ERR cannot open your own case");
+            return;
+        }
+        if (isOpened(caseIndex)) {
+            reply.put("ERR case already opened");
+            return;
+        }
+
+        openedMask = static_cast<Mask>(openedMask | (1u << caseIndex));
+        remainingCount--;
+        remainingSum -= caseCents(rules, caseIndex);
+        picksLeft--;
+
+        reply.put("OK OPENED ").putInt(choice.value).put(' ').putCents(caseCents(rules, caseIndex)).put(' ');
+        if (picksLeft > 0) {
+            reply.put("LEFT ").putInt(picksLeft);
+        } else if (remainingCount <= 1) {
+            finish(rules, reply);
+        } else {
+            offer = bank.offer(rules, round, remainingPrizeMask());
+            phase = Phase::Decide;
+            reply.put("OFFER ").putCents(offer).put(" ROUND ").putInt(round);
+        }
+    }
+
+    void onDecision(const Rules& rules, bool accepted, TextWriter& reply) {
+        if (phase != Phase::Decide) {
+            reply.put("ERR no offer pending");
+            return;
+        }
+        if (accepted) {
+            phase = Phase::Finished;
+            reply.put("OK DEAL ").putCents(offer).put(" HELD ").putCents(caseCents(rules, playerCase));
+            return;
+        }
+
+        reply.put("OK NODEAL ");
+        round++;
+        if (round > rules.rounds && rules.finalSwap) {
+            phase = Phase::Swap;
+            reply.put("SWAP ").putInt(otherCase() + 1);
+        } else if (round > rules.rounds) {
+            finish(rules, reply);
+        } else {
+            startRound(rules, reply);
+        }
+    }
+
+    // The one unopened case other than the player's, at the final swap
+    int otherCase() const {
+        for (int i = 0; i < Cases; i++) {
+            if (!isOpened(i) && i != playerCase) return i;
+        }
+        return playerCase;
+    }
+
+    void onSwap(const Rules& rules, bool swap, TextWriter& reply) {
+        if (phase != Phase::Swap) {
+            reply.put("ERR no swap offered");
+            return;
+        }
+        if (swap) playerCase = static_cast<std::int8_t>(otherCase());
+        reply.put(swap ? "OK SWAP " : "OK KEEP ");
+        finish(rules, reply);
+    }
+
+    void onAdvice(const Rules& rules, TextWriter& reply, const ComputerPlayer& advisor) {
+        BasicPrizeRanks<Cases> prizes(rules.board, remainingPrizeMask());
+        if (phase == Phase::Swap) {
+            reply.put("OK ADVICE ").put(advisor.shouldSwap(prizes) ? "SWAP" : "KEEP");
+            reply.put(" EV ").putFixed(toDollars(remainingSum) / remainingCount, 2);
+            return;
+        }
+        if (phase != Phase::Decide) {
+            reply.put("ERR no offer pending");
+            return;
+        }
+        bool deal;
+        {
+            metrics::ScopedLatency timer(metrics::Histogram::Decision);
+            deal = advisor.shouldAcceptDeal(prizes, toDollars(offer), remainingCount);
+        }
+        reply.put("OK ADVICE ").put(deal ? "DEAL" : "NODEAL");
+        reply.put(" EV ").putFixed(toDollars(remainingSum) / remainingCount, 2);
+        reply.put(" OFFER ").putCents(offer);
+    }
+
+    // The next offer over every way the cases still to open before it
+    // could fall: this round's while opening, the next round's at an offer
+    void onPreview(const Rules& rules, const BankModel& bank, TextWriter& reply, OfferPreviewCache* previews) {
+        OfferPreview preview;
+        bool coming = false;
+        if (phase == Phase::OpenCases) {
+            coming = previewNextOffer(rules, bank, previews, round, remainingPrizeMask(), picksLeft, 0, preview);
+        } else if (phase == Phase::Decide && round < rules.rounds) {
+            int picks = std::min<int>(rules.casesPerRound[round], remainingCount - 1);
+            coming = previewNextOffer(rules, bank, previews, round + 1, remainingPrizeMask(), picks, offer, preview);
+        }
+        if (!coming) {
+            reply.put("ERR no offer to come");
+            return;
+        }
+        reply.put("OK PREVIEW ROUND ").putInt(preview.round).put(" WAYS ").putInt(preview.ways);
+        reply.put(" LOW ").putCents(preview.low).put(" MEDIAN ").putCents(preview.median);
+        reply.put(" MEAN ").putFixed(preview.mean, 2).put(" HIGH ").putCents(preview.high);
+        if (phase == Phase::Decide) reply.put(" BEATS ").putFixed(preview.beats, 4);
+    }
+
+public:
+    BasicGameSession() {
+        reset();
+    }
+
+    void reset() {
+        for (int i = 0; i < Cases; i++) casePrize[i] = 0;
+        openedMask = 0;
+        phase = Phase::Idle;
+        closing = false;
+        playerCase = -1;
+        round = 0;
+        picksLeft = 0;
+        remainingCount = 0;
+        remainingSum = 0;
+        offer = 0;
+    }
+
+    // Deal a fresh board from `seed` (same portable shuffle as replays)
+    void start(const Rules& rules, std::uint64_t seed) {
+        reset();
+        for (int i = 0; i < Cases; i++) casePrize[i] = static_cast<std::uint8_t>(i);
+        remainingSum = rules.board.total;
+        replay::shuffleWithSeed(seed, casePrize, Cases);
+        remainingCount = Cases;
+        phase = Phase::ChooseCase;
+    }
+
+    // Apply one command line and write a single reply line (without '\n').
+    // PREVIEW goes through `previews` when there is one; it must belong to
+    // these rules and this bank.
+    void handle(const Rules& rules, const BankModel& bank, std::string_view line, TextWriter& reply,
+                const ComputerPlayer& advisor, std::uint64_t& seedState, OfferPreviewCache* previews = nullptr) {
+        line = trimInput(line);
+        std::string_view::size_type space = line.find(' ');
+        std::string_view command = line.substr(0, space);
+        std::string_view argument = space == std::string_view::npos ? std::string_view()
+                                                                   : trimInput(line.substr(space + 1));
+
+        if (matches(command, "NEW")) {
+            onNew(rules, argument, reply, seedState);
+        } else if (matches(command, "CASE")) {
+            onCase(rules, argument, reply);
+        } else if (matches(command, "OPEN")) {
+            onOpen(rules, bank, argument, reply);
+        } else if (matches(command, "DEAL")) {
+            onDecision(rules, true, reply);
+        } else if (matches(command, "NODEAL")) {
+            onDecision(rules, false, reply);
+        } else if (matches(command, "SWAP")) {
+            onSwap(rules, true, reply);
+        } else if (matches(command, "KEEP")) {
+            onSwap(rules, false, reply);
+        } else if (matches(command, "ADVICE")) {
+            onAdvice(rules, reply, advisor);
+        } else if (matches(command, "PREVIEW")) {
+            onPreview(rules, bank, reply, previews);
+        } else if (matches(command, "STATE")) {
+            reply.put("OK STATE ").put(phaseName(phase));
+            reply.put(" ROUND ").putInt(round).put(" REMAINING ").putInt(remainingCount);
+        } else if (matches(command, "QUIT")) {
+            closing = true;
+            reply.put("OK BYE");
+        } else {
+            reply.put("ERR unknown command");
+        }
+    }
+
+    Phase currentPhase() const {
+        return phase;
+    }
+
+    int currentRound() const {
+        return round;
+    }
+
+    // The client asked to close the connection
+    bool wantsClose() const {
+        return closing;
+    }
+};
+
+using GameSession = BasicGameSession<StandardVariant>;
+
+static_assert(sizeof(GameSession) <= 64, "GameSession must fit in one cache line");
+static_assert(std::is_trivially_copyable<GameSession>::value, "GameSession must be trivially copyable");
+
+#endif // DEALMASTER_GAME_SESSION_H
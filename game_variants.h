@@ -0,0 +1,122 @@
+#ifndef DEALMASTER_GAME_VARIANTS_H
+#define DEALMASTER_GAME_VARIANTS_H
+
+#include <cstdint>
+#include <string_view>
+#include <type_traits>
+
+#include "game_rules.h"
+
+// Show formats compiled into the engine.
+//
+// A variant fixes the number of cases, the round schedule and the prize
+// list at compile time. The game engine, the hosted session and the prize
+// board are templates over the variant, so every per-case loop has a
+// constant trip count and case/prize sets use the narrowest mask type.
+// To add a format, define its struct below and list it in VariantList.
+
+// Bit set over the cases (or prizes) of a board
+template <int CaseCount>
+using CaseMask = std::conditional_t<(CaseCount <= 16), std::uint16_t, std::uint32_t>;
+
+// The US-style 26-case show
+struct StandardVariant {
+    static constexpr std::string_view Name = "standard";
+    static constexpr int Cases = 26;
+    static constexpr int Rounds = 9;
+    static constexpr int BoardColumns = 13;
+    static constexpr const int (&CasesPerRound)[Rounds] = CASES_PER_ROUND;
+    static constexpr const double (&Prizes)[Cases] = STANDARD_PRIZES;
+};
+
+// 22 boxes: five opened before the first offer, then three per round
+struct Regional22Variant {
+    static constexpr std::string_view Name = "regional22";
+    static constexpr int Cases = 22;
+    static constexpr int Rounds = 6;
+    static constexpr int BoardColumns = 11;
+    static constexpr int CasesPerRound[Rounds] = {5, 3, 3, 3, 3, 3};
+    static constexpr double Prizes[Cases] = {
+        0.01, 0.10, 0.50, 1.0, 5.0, 10.0, 50.0, 100.0, 250.0, 500.0, 750.0,
+        1000.0, 3000.0, 5000.0, 10000.0, 15000.0, 20000.0, 35000.0, 50000.0,
+        75000.0, 100000.0, 250000.0
+    };
+};
+
+// Short 16-case format
+struct Compact16Variant {
+    static constexpr std::string_view Name = "compact16";
+    static constexpr int Cases = 16;
+    static constexpr int Rounds = 6;
+    static constexpr int BoardColumns = 8;
+    static constexpr int CasesPerRound[Rounds] = {4, 3, 3, 2, 1, 1};
+    static constexpr double Prizes[Cases] = {
+        0.01, 1.0, 5.0, 10.0, 25.0, 50.0, 100.0, 250.0,
+        500.0, 1000.0, 5000.0, 10000.0, 25000.0, 50000.0, 100000.0, 250000.0
+    };
+};
+
+template <class... Variants>
+struct VariantList {};
+
+using AllVariants = VariantList<StandardVariant, Regional22Variant, Compact16Variant>;
+
+// Largest board of any variant; sizes fixed-capacity buffers shared by all
+inline constexpr int MaxVariantCases = 26;
+
+namespace variant_detail {
+
+// A schedule must open every case but the player's and one other, so the
+// last offer is made with two cases left
+template <class Variant>
+constexpr bool scheduleOpensAllButTwo() {
+    int opened = 0;
+    for (int i = 0; i < Variant::Rounds; i++) {
+        if (Variant::CasesPerRound[i] < 1 || Variant::CasesPerRound[i] > 7) return false;
+        opened += Variant::CasesPerRound[i];
+    }
+    return opened == Variant::Cases - 2;
+}
+
+template <class Variant>
+constexpr bool checkVariant() {
+    static_assert(Variant::Cases >= 4 && Variant::Cases <= MaxVariantCases, "Unsupported board size");
+    static_assert(Variant::Rounds >= 1 && Variant::Rounds <= 9, "Unsupported number of rounds");
+    static_assert(scheduleOpensAllButTwo<Variant>(), "Round schedule must leave two cases for the last offer");
+    return true;
+}
+
+template <class Visitor, class First, class... Rest>
+bool dispatch(std::string_view name, Visitor& visit, VariantList<First, Rest...>) {
+    static_assert(checkVariant<First>(), "Invalid variant");
+    if (name == First::Name) {
+        visit(First{});
+        return true;
+    }
+    if constexpr (sizeof...(Rest) > 0) {
+        return dispatch(name, visit, VariantList<Rest...>{});
+    } else {
+        return false;
+    }
+}
+
+template <class Visitor, class... Variants>
+void forEach(Visitor& visit, VariantList<Variants...>) {
+    (visit(Variants{}), ...);
+}
+
+} // namespace variant_detail
+
+// Call visit(Variant{}) for the variant called `name`; false if unknown.
+// The visitor is a generic lambda, so each variant gets its own code path.
+template <class Visitor>
+bool withVariant(std::string_view name, Visitor&& visit) {
+    return variant_detail::dispatch(name, visit, AllVariants{});
+}
+
+template <class Visitor>
+void forEachVariant(Visitor&& visit) {
+    variant_detail::forEach(visit, AllVariants{});
+}
+
+#endif // DEALMASTER_GAME_VARIANTS_H
@@ -0,0 +1,78 @@
+#ifndef DEALMASTER_INPUT_PARSER_H
+#define DEALMASTER_INPUT_PARSER_H
+
+#include <charconv>
+#include <string_view>
+#include <system_error>
+
+// Allocation-free, exception-free parsing of player input lines. Ordinary
+// bad input is reported through ParseError; exceptions are reserved for
+// real faults such as the input stream closing.
+enum class ParseError {
+    None,
+    Empty,
+    NonNumeric,
+    OutOfRange,
+    InvalidChoice
+};
+
+struct ParseResult {
+    int value;
+    ParseError error;
+
+    bool ok() const noexcept {
+        return error == ParseError::None;
+    }
+};
+
+// Human-readable reason, matching the old InvalidInputException messages
+inline const char* describeParseError(ParseError error) noexcept {
+    switch (error) {
+        case ParseError::None:          return "OK";
+        case ParseError::Empty:         return "Empty input";
+        case ParseError::NonNumeric:    return "Non-numeric input";
+        case ParseError::OutOfRange:    return "Input out of range";
+        case ParseError::InvalidChoice: return "Invalid choice";
+    }
+    return "Unknown error";
+}
+
+// Strip surrounding blanks (including the '\r' of CRLF scripts)
+inline std::string_view trimInput(std::string_view line) noexcept {
+    const char* blanks = " \t\r\n";
+    std::string_view::size_type first = line.find_first_not_of(blanks);
+    if (first == std::string_view::npos) return std::string_view();
+    std::string_view::size_type last = line.find_last_not_of(blanks);
+    return line.substr(first, last - first + 1);
+}
+
+// Parse a whole line as an integer in [min, max]
+inline ParseResult parseInt(std::string_view line, int min, int max) noexcept {
+    line = trimInput(line);
+    if (line.empty()) return {0, ParseError::Empty};
+
+    int value = 0;
+    const char* begin = line.data();
+    const char* end = begin + line.size();
+    std::from_chars_result result = std::from_chars(begin, end, value);
+
+    if (result.ec == std::errc::result_out_of_range) return {0, ParseError::OutOfRange};
+    if (result.ec != std::errc() || result.ptr != end) return {0, ParseError::NonNumeric};
+    if (value < min || value > max) return {value, ParseError::OutOfRange};
+
+    return {value, ParseError::None};
+}
+
+// Parse a y/n answer; value is 1 for yes and 0 for no
+inline ParseResult parseYesNo(std::string_view line) noexcept {
+    line = trimInput(line);
+    if (line.empty()) return {0, ParseError::Empty};
+
+    switch (line[0]) {
+        case 'y': case 'Y': return {1, ParseError::None};
+        case 'n': case 'N': return {0, ParseError::None};
+        default:            return {0, ParseError::InvalidChoice};
+    }
+}
+
+#endif // DEALMASTER_INPUT_PARSER_H
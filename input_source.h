@@ -0,0 +1,147 @@
+#ifndef DEALMASTER_INPUT_SOURCE_H
+#define DEALMASTER_INPUT_SOURCE_H
+
+#include <cstddef>
+#include <istream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Where the game reads player moves from. The interactive front-end reads
+// lines from std::cin; batch mode replays moves from a script in memory.
+class InputSource {
+public:
+    virtual ~InputSource() = default;
+
+    // Fetch the next answer. Returns false when no more input is available.
+    // The view stays valid until the next call.
+    virtual bool readLine(std::string_view& line) = 0;
+};
+
+// Line-by-line input from a stream (normally std::cin)
+class StreamInput : public InputSource {
+private:
+    std::istream& in;
+    std::string line;
+
+public:
+    explicit StreamInput(std::istream& stream) : in(stream) {}
+
+    bool readLine(std::string_view& result) override {
+        if (!std::getline(in, line)) return false;
+        result = line;
+        return true;
+    }
+};
+
+// Scripted player moves for batch mode.
+//
+// A script is a list of sessions separated by lines containing only "---".
+// Inside a session, answers are separated by whitespace, commas or
+// newlines, and '#' starts a comment. The answers are exactly what a
+// player would type: the lucky case, the cases to open each round and the
+// y/n deal answers, e.g.
+//
+//     7  1 2 3 4 5 6  n  8 9 10 11 12  y
+//     ---
+//     13 1,2,3,4,5,6 n 7,8,9,10,11 n 12,14,15,16 y
+//
+// The whole script is tokenised once at load time so that replaying it
+// does no allocation.
+class ScriptInput : public InputSource {
+private:
+    std::string text;
+    std::vector<std::string_view> tokens;
+    std::vector<std::size_t> sessionStarts; // Token index where each session begins
+    std::size_t cursor;
+    std::size_t sessionEnd;
+
+    static bool isSeparator(char ch) {
+        return ch == ' ' || ch == '\t' || ch == '\r' || ch == ',';
+    }
+
+    static bool isSessionBreak(std::string_view line) {
+        while (!line.empty() && isSeparator(line.back())) line.remove_suffix(1);
+        while (!line.empty() && isSeparator(line.front())) line.remove_prefix(1);
+        return line == "---";
+    }
+
+    void tokenise() {
+        std::string_view all(text);
+        std::size_t lineStart = 0;
+        sessionStarts.push_back(0);
+
+        while (lineStart < all.size()) {
+            std::size_t lineEnd = all.find('\n', lineStart);
+            if (lineEnd == std::string_view::npos) lineEnd = all.size();
+            std::string_view line = all.substr(lineStart, lineEnd - lineStart);
+            lineStart = lineEnd + 1;
+
+            std::size_t comment = line.find('#');
+            if (comment != std::string_view::npos) line = line.substr(0, comment);
+
+            if (isSessionBreak(line)) {
+                if (tokens.size() > sessionStarts.back()) {
+                    sessionStarts.push_back(tokens.size());
+                }
+                continue;
+            }
+
+            std::size_t i = 0;
+            while (i < line.size()) {
+                while (i < line.size() && isSeparator(line[i])) i++;
+                std::size_t begin = i;
+                while (i < line.size() && !isSeparator(line[i])) i++;
+                if (i > begin) tokens.push_back(line.substr(begin, i - begin));
+            }
+        }
+
+        // Drop a trailing empty session (script ending in "---")
+        if (sessionStarts.size() > 1 && sessionStarts.back() == tokens.size()) {
+            sessionStarts.pop_back();
+        }
+        if (tokens.empty()) sessionStarts.clear();
+    }
+
+public:
+    explicit ScriptInput(std::string scriptText)
+        : text(std::move(scriptText)), cursor(0), sessionEnd(0) {
+        tokenise();
+    }
+
+    ScriptInput(const ScriptInput&) = delete;
+    ScriptInput& operator=(const ScriptInput&) = delete;
+
+    std::size_t sessionCount() const {
+        return sessionStarts.size();
+    }
+
+    // Position the cursor at the first answer of session `index`
+    void beginSession(std::size_t index) {
+        cursor = sessionStarts[index];
+        sessionEnd = index + 1 < sessionStarts.size() ? sessionStarts[index + 1] : tokens.size();
+    }
+
+    // Answers of session `index` as a token range, for callers that walk
+    // several sessions side by side (e.g. the load generator)
+    const std::string_view* answersBegin(std::size_t index) const {
+        return tokens.data() + sessionStarts[index];
+    }
+
+    const std::string_view* answersEnd(std::size_t index) const {
+        return tokens.data() + (index + 1 < sessionStarts.size() ? sessionStarts[index + 1] : tokens.size());
+    }
+
+    // Answers of the current session that the game did not consume
+    std::size_t unusedAnswers() const {
+        return sessionEnd - cursor;
+    }
+
+    bool readLine(std::string_view& line) override {
+        if (cursor >= sessionEnd) return false;
+        line = tokens[cursor++];
+        return true;
+    }
+};
+
+#endif // DEALMASTER_INPUT_SOURCE_H
@@ -0,0 +1,245 @@
+#ifndef DEALMASTER_INSTRUMENTATION_H
+#define DEALMASTER_INSTRUMENTATION_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+#include <new>
+#include <string_view>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "frame_buffer.h"
+
+// Build with -DDEALMASTER_INSTRUMENT=1 to time the phases of the game loop.
+// In a default build every ScopedPhase is an empty object and compiles away.
+#ifndef DEALMASTER_INSTRUMENT
+#define DEALMASTER_INSTRUMENT 0
+#endif
+
+namespace instrument {
+
+inline constexpr bool Enabled = DEALMASTER_INSTRUMENT != 0;
+
+enum class Phase : std::uint8_t {
+    Shuffle,
+    OpenCases,
+    UpdateRemaining,
+    Offer,
+    Decision,       // Computer player and advisor
+    Render,
+    Count
+};
+
+inline constexpr int PhaseCount = static_cast<int>(Phase::Count);
+inline constexpr std::string_view PhaseNames[PhaseCount + 1] = {
+    "shuffle", "open_cases", "update_remaining", "offer", "decision", "render", "other"
+};
+
+// Every call is counted but only one in SamplePeriod is timed: a phase can
+// be shorter than a pair of cycle-counter reads, and timing each call would
+// cost more than the 1% the whole surface is allowed.
+inline constexpr std::uint32_t SamplePeriod = 64;
+
+// Cycle counter (RDTSC on x86, the steady clock in nanoseconds elsewhere)
+inline std::uint64_t readCycles() {
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// One thread's counters. Only the owning thread writes them, with relaxed
+// stores, so the hot path takes no lock and shares no cache line; the dump
+// reads every block. Blocks are never freed, so the counts of threads that
+// have finished still reach the dump. Heap allocations are charged to the
+// innermost phase open on the thread, or to "other" (index PhaseCount).
+struct alignas(64) ThreadCounters {
+    std::atomic<std::uint64_t> calls[PhaseCount] = {};
+    std::atomic<std::uint64_t> timed[PhaseCount] = {};
+    std::atomic<std::uint64_t> cycles[PhaseCount] = {};
+    std::atomic<std::uint64_t> allocations[PhaseCount + 1] = {};
+    std::atomic<std::uint64_t> bytes[PhaseCount + 1] = {};
+    ThreadCounters* next = nullptr;
+};
+
+// Registered blocks, pushed lock-free
+inline std::atomic<ThreadCounters*> threadList{nullptr};
+inline thread_local ThreadCounters* threadCounters = nullptr;
+inline thread_local int currentPhase = PhaseCount;
+
+// Cycle counter and clock at the first registration, to convert cycles to time
+struct Calibration {
+    std::uint64_t cycles;
+    std::chrono::steady_clock::time_point time;
+};
+
+inline const Calibration& calibration() {
+    static const Calibration start{readCycles(), std::chrono::steady_clock::now()};
+    return start;
+}
+
+// Blocks come from malloc, not new: countAllocation() registers the thread
+// from inside operator new
+inline ThreadCounters& registerThread() {
+    calibration();
+    std::size_t space = sizeof(ThreadCounters) + alignof(ThreadCounters);
+    void* memory = std::malloc(space);
+    if (!memory) std::abort();
+    ThreadCounters* counters = new (std::align(alignof(ThreadCounters), sizeof(ThreadCounters), memory, space))
+        ThreadCounters();
+    counters->next = threadList.load(std::memory_order_relaxed);
+    while (!threadList.compare_exchange_weak(counters->next, counters, std::memory_order_release,
+                                             std::memory_order_relaxed)) {
+    }
+    threadCounters = counters;
+    return *counters;
+}
+
+inline ThreadCounters& localCounters() {
+    return threadCounters ? *threadCounters : registerThread();
+}
+
+// Single-writer increment: a plain add, no locked instruction
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+// Counts (and every SamplePeriod-th time, times) the enclosing scope
+template <bool On>
+class BasicScopedPhase {
+private:
+    ThreadCounters& counters;
+    int phase;
+    int outer;
+    std::uint64_t started;
+
+public:
+    explicit BasicScopedPhase(Phase which)
+        : counters(localCounters()), phase(static_cast<int>(which)), outer(currentPhase), started(0) {
+        currentPhase = phase;
+        std::uint64_t calls = counters.calls[phase].load(std::memory_order_relaxed);
+        counters.calls[phase].store(calls + 1, std::memory_order_relaxed);
+        if (calls % SamplePeriod == 0) started = readCycles();
+    }
+
+    ~BasicScopedPhase() {
+        currentPhase = outer;
+        if (started == 0) return;
+        bump(counters.cycles[phase], readCycles() - started);
+        bump(counters.timed[phase], 1);
+    }
+
+    BasicScopedPhase(const BasicScopedPhase&) = delete;
+    BasicScopedPhase& operator=(const BasicScopedPhase&) = delete;
+};
+
+template <>
+class BasicScopedPhase<false> {
+public:
+    explicit BasicScopedPhase(Phase) {}
+};
+
+using ScopedPhase = BasicScopedPhase<Enabled>;
+
+// Called by the replacement operator new of the program; compiles to
+// nothing in a default build
+inline void countAllocation(std::size_t size) {
+    if constexpr (Enabled) {
+        ThreadCounters& counters = localCounters();
+        bump(counters.allocations[currentPhase], 1);
+        bump(counters.bytes[currentPhase], size);
+    }
+}
+
+// Totals of one phase over every thread
+struct PhaseTotals {
+    std::uint64_t calls = 0;
+    std::uint64_t timed = 0;
+    std::uint64_t cycles = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t bytes = 0;
+
+    double cyclesPerCall() const {
+        return timed > 0 ? static_cast<double>(cycles) / timed : 0.0;
+    }
+};
+
+// Totals of every phase, then of allocations outside any phase
+inline void collect(PhaseTotals (&totals)[PhaseCount + 1]) {
+    for (int p = 0; p <= PhaseCount; p++) totals[p] = PhaseTotals();
+    for (ThreadCounters* counters = threadList.load(std::memory_order_acquire); counters; counters = counters->next) {
+        for (int p = 0; p < PhaseCount; p++) {
+            totals[p].calls += counters->calls[p].load(std::memory_order_relaxed);
+            totals[p].timed += counters->timed[p].load(std::memory_order_relaxed);
+            totals[p].cycles += counters->cycles[p].load(std::memory_order_relaxed);
+        }
+        for (int p = 0; p <= PhaseCount; p++) {
+            totals[p].allocations += counters->allocations[p].load(std::memory_order_relaxed);
+            totals[p].bytes += counters->bytes[p].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Cycles per nanosecond since the first registration (1 without RDTSC)
+inline double cyclesPerNanosecond() {
+    const Calibration& start = calibration();
+    double nanoseconds = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start.time).count();
+    std::uint64_t cycles = readCycles() - start.cycles;
+    return nanoseconds > 0.0 && cycles > 0 ? cycles / nanoseconds : 1.0;
+}
+
+// Write the totals as an aligned table, or as one JSON object. Total times
+// are estimated from the sampled calls; the last row holds the allocations
+// made outside every phase.
+inline void dump(FrameBuffer& out, bool json) {
+    PhaseTotals totals[PhaseCount + 1];
+    collect(totals);
+    double rate = cyclesPerNanosecond();
+
+    if (json) {
+        out.put("{\"cycles_per_ns\":").putFixed(rate, 3).put(",\"sample_period\":").putUnsigned(SamplePeriod);
+        out.put(",\"phases\":[");
+        for (int p = 0; p <= PhaseCount; p++) {
+            const PhaseTotals& total = totals[p];
+            out.put(p > 0 ? "," : "").put("{\"phase\":\"").put(PhaseNames[p]).put('"');
+            out.put(",\"calls\":").putUnsigned(total.calls).put(",\"timed\":").putUnsigned(total.timed);
+            out.put(",\"cycles_per_call\":").putFixed(total.cyclesPerCall(), 1);
+            out.put(",\"ns_per_call\":").putFixed(total.cyclesPerCall() / rate, 1);
+            out.put(",\"total_ms\":").putFixed(total.cyclesPerCall() * total.calls / rate / 1e6, 3);
+            out.put(",\"allocations\":").putUnsigned(total.allocations);
+            out.put(",\"bytes\":").putUnsigned(total.bytes).put('}');
+        }
+        out.put("]}\n");
+        out.flush();
+        return;
+    }
+
+    out.put("=== PROFILE (1 in ").putUnsigned(SamplePeriod).put(" calls timed, ");
+    out.putFixed(rate, 2).put(" cycles/ns) ===\n");
+    out.put("phase                    calls   cycles/call   ns/call   total ms      allocs       bytes\n");
+    for (int p = 0; p <= PhaseCount; p++) {
+        const PhaseTotals& total = totals[p];
+        out.put(PhaseNames[p]).repeat(' ', 18 - PhaseNames[p].size());
+        out.putInt(static_cast<long long>(total.calls), 12);
+        out.putInt(static_cast<long long>(total.cyclesPerCall() + 0.5), 14);
+        out.putInt(static_cast<long long>(total.cyclesPerCall() / rate + 0.5), 10);
+        out.put("   ").putFixed(total.cyclesPerCall() * total.calls / rate / 1e6, 3);
+        out.putInt(static_cast<long long>(total.allocations), 12);
+        out.putInt(static_cast<long long>(total.bytes), 12).newline();
+    }
+    out.flush();
+}
+
+} // namespace instrument
+
+#endif // DEALMASTER_INSTRUMENTATION_H
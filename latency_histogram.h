@@ -0,0 +1,115 @@
+#ifndef DEALMASTER_LATENCY_HISTOGRAM_H
+#define DEALMASTER_LATENCY_HISTOGRAM_H
+
+#include <cstdint>
+
+#include "bit_ops.h"
+
+// Fixed-size log-linear histogram of durations in nanoseconds.
+//
+// Values below 32 get a bucket each; above that every power of two is
+// split into 32 equal sub-buckets, so a reported percentile is within about
+// 3% of the true value. Recording is a couple of shifts and an increment
+// and never allocates; values past 2^40 ns (about 18 minutes) land in the
+// last bucket.
+class LatencyHistogram {
+public:
+    static constexpr int SubBucketBits = 5;
+    static constexpr int SubBuckets = 1 << SubBucketBits;
+    static constexpr int MaxMagnitude = 40;
+    static constexpr int BucketCount = SubBuckets + (MaxMagnitude - SubBucketBits) * SubBuckets;
+
+private:
+    std::uint64_t buckets[BucketCount];
+    std::uint64_t total;
+    std::uint64_t sum;
+    std::uint64_t minimum;
+    std::uint64_t maximum;
+
+    static int magnitude(std::uint64_t value) {
+        return highestBit(value);
+    }
+
+    static int bucketOf(std::uint64_t value) {
+        if (value < SubBuckets) return static_cast<int>(value);
+        int top = magnitude(value);
+        if (top >= MaxMagnitude) return BucketCount - 1;
+        int shift = top - SubBucketBits;
+        int sub = static_cast<int>(value >> shift) - SubBuckets;
+        return SubBuckets + shift * SubBuckets + sub;
+    }
+
+    // Largest value that maps to `bucket`
+    static std::uint64_t upperBound(int bucket) {
+        if (bucket < SubBuckets) return static_cast<std::uint64_t>(bucket);
+        int shift = (bucket - SubBuckets) / SubBuckets;
+        std::uint64_t sub = static_cast<std::uint64_t>((bucket - SubBuckets) % SubBuckets);
+        return ((SubBuckets + sub + 1) << shift) - 1;
+    }
+
+public:
+    LatencyHistogram() {
+        reset();
+    }
+
+    void reset() {
+        for (int i = 0; i < BucketCount; i++) buckets[i] = 0;
+        total = 0;
+        sum = 0;
+        minimum = 0;
+        maximum = 0;
+    }
+
+    void record(std::uint64_t nanoseconds) {
+        buckets[bucketOf(nanoseconds)]++;
+        if (total == 0 || nanoseconds < minimum) minimum = nanoseconds;
+        if (nanoseconds > maximum) maximum = nanoseconds;
+        total++;
+        sum += nanoseconds;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        if (other.total == 0) return;
+        for (int i = 0; i < BucketCount; i++) buckets[i] += other.buckets[i];
+        if (total == 0 || other.minimum < minimum) minimum = other.minimum;
+        if (other.maximum > maximum) maximum = other.maximum;
+        total += other.total;
+        sum += other.sum;
+    }
+
+    // Value at or below which `fraction` (0..1) of the samples fall
+    std::uint64_t percentile(double fraction) const {
+        if (total == 0) return 0;
+        std::uint64_t rank = static_cast<std::uint64_t>(fraction * static_cast<double>(total) + 0.5);
+        if (rank < 1) rank = 1;
+        if (rank > total) rank = total;
+
+        std::uint64_t seen = 0;
+        for (int i = 0; i < BucketCount; i++) {
+            seen += buckets[i];
+            if (seen >= rank) {
+                std::uint64_t bound = upperBound(i);
+                return bound < maximum ? bound : maximum;
+            }
+        }
+        return maximum;
+    }
+
+    std::uint64_t count() const {
+        return total;
+    }
+
+    double mean() const {
+        return total == 0 ? 0.0 : static_cast<double>(sum) / static_cast<double>(total);
+    }
+
+    std::uint64_t min() const {
+        return minimum;
+    }
+
+    std::uint64_t max() const {
+        return maximum;
+    }
+};
+
+#endif // DEALMASTER_LATENCY_HISTOGRAM_H
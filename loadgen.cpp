@@ -0,0 +1,785 @@
+// Load generator for the game server (dealmaster --serve).
+//
+// Opens N connections to a local server, plays complete games on each of
+// them (ComputerPlayer-driven or from a batch-mode script) with one request
+// in flight per connection, optionally paced to a global request rate, and
+// prints per-request-type latency percentiles as JSON.
+//
+// Build: g++ -std=c++17 -O2 -Wall -o dealmaster-loadgen loadgen.cpp
+
+#if !defined(__linux__)
+
+#include <iostream>
+
+int main() {
+    std::cout << "dealmaster-loadgen requires Linux (epoll)" << std::endl;
+    return 1;
+}
+
+#else
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "computer_player.h"
+#include "frame_buffer.h"
+#include "game_rules.h"
+#include "game_variants.h"
+#include "prize_board.h"
+#include "input_parser.h"
+#include "input_source.h"
+#include "latency_histogram.h"
+#include "money.h"
+#include "text_writer.h"
+#include "variant_rules.h"
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Request types reported separately. An OPEN that closes a round is
+// reported as "offer" because the server computes the bank offer for it.
+enum class RequestKind : std::uint8_t {
+    New,
+    Case,
+    Open,
+    Offer,
+    Deal,
+    Count
+};
+
+const char* const RequestNames[] = {"new", "case", "open", "offer", "deal"};
+
+template <int N>
+std::vector<Cents> boardValues(const BasicPrizeBoard<N>& board) {
+    return std::vector<Cents>(board.cents, board.cents + N);
+}
+
+struct LoadOptions {
+    std::string endpoint;
+    std::string scriptPath;          // Empty: ComputerPlayer-driven games
+    std::string outputPath;          // Empty: JSON on stdout
+    int connections = 100;
+    long long games = 1000;          // Total games across all connections
+    double rate = 0.0;               // Requests per second, 0 = unpaced
+    double duration = 0.0;           // Seconds, 0 = until all games are played
+    std::uint64_t seed = 1;
+    std::string variant = std::string(StandardVariant::Name);   // Must match the server's --variant(-file)
+    int cases = StandardVariant::Cases;
+    std::vector<Cents> prizes = boardValues(BuiltinRules<StandardVariant>.board);
+};
+
+struct LoadTotals {
+    long long gamesCompleted = 0;
+    long long gamesFailed = 0;
+    long long deals = 0;
+    long long errors = 0;            // ERR replies
+    long long rejected = 0;          // Connections refused with "ERR server full"
+    long long disconnects = 0;       // Connections lost mid-game
+    CentsTotal winnings;             // Exact, whatever the number of games
+    double seconds = 0.0;
+};
+
+// One client connection and what it knows about its current game
+struct Client {
+    int fd = -1;
+    bool busy = false;               // A request is in flight
+    bool quitting = false;
+    RequestKind pending = RequestKind::New;
+    Clock::time_point sentAt;
+    std::size_t inLength = 0;
+    char in[512];
+    std::size_t queuedLength = 0;    // Paced mode: command waiting for its send slot
+    char queued[64];
+
+    bool opened[MaxVariantCases];
+    int playerCase = -1;
+    int remainingCount = 0;
+    Cents remaining[MaxVariantCases];   // Unrevealed prizes, including the player's case
+    const std::string_view* answer = nullptr;
+    const std::string_view* answerEnd = nullptr;
+};
+
+int connectEndpoint(std::string_view endpoint) {
+    int fd = -1;
+    if (endpoint.substr(0, 5) == "unix:") {
+        std::string path(endpoint.substr(5));
+        sockaddr_un address{};
+        if (path.size() >= sizeof(address.sun_path)) return -1;
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, path.c_str(), path.size() + 1);
+        fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+    } else if (endpoint.substr(0, 4) == "tcp:") {
+        std::string_view spec = endpoint.substr(4);
+        std::string host = "127.0.0.1";
+        std::string_view::size_type colon = spec.rfind(':');
+        if (colon != std::string_view::npos) {
+            host = std::string(spec.substr(0, colon));
+            spec = spec.substr(colon + 1);
+        }
+        ParseResult port = parseInt(spec, 1, 65535);
+        sockaddr_in address{};
+        address.sin_family = AF_INET;
+        address.sin_port = htons(static_cast<std::uint16_t>(port.value));
+        if (!port.ok() || ::inet_pton(AF_INET, host.c_str(), &address.sin_addr) != 1) return -1;
+        fd = ::socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) return -1;
+        if (::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0) {
+            ::close(fd);
+            return -1;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    } else {
+        return -1;
+    }
+
+    ::fcntl(fd, F_SETFL, ::fcntl(fd, F_GETFL) | O_NONBLOCK);
+    return fd;
+}
+
+// Split "WORD WORD ..." into at most `capacity` words
+std::size_t splitWords(std::string_view line, std::string_view* words, std::size_t capacity) {
+    std::size_t count = 0;
+    std::size_t i = 0;
+    while (i < line.size() && count < capacity) {
+        while (i < line.size() && line[i] == ' ') i++;
+        std::size_t begin = i;
+        while (i < line.size() && line[i] != ' ') i++;
+        if (i > begin) words[count++] = line.substr(begin, i - begin);
+    }
+    return count;
+}
+
+
+class LoadGenerator {
+private:
+    LoadOptions options;
+    std::vector<Client> clients;
+    ScriptInput* script;
+    const ComputerPlayer& advisor;
+    std::mt19937_64 rng;
+    LatencyHistogram latency[static_cast<int>(RequestKind::Count)];
+    LoadTotals totals;
+    long long gamesStarted;
+    int epollFd;
+    int liveClients;
+
+    // Pacing: clients waiting for a send slot, and the next slot's time
+    std::vector<std::uint32_t> readyQueue;
+    std::size_t readyHead;
+    std::size_t readyCount;
+    Clock::time_point nextSlot;
+    Clock::duration slotInterval;
+
+    std::vector<double> prizeScratch;
+
+    void markReady(std::uint32_t index) {
+        readyQueue[(readyHead + readyCount) % readyQueue.size()] = index;
+        readyCount++;
+    }
+
+    void closeClient(Client& client) {
+        if (client.fd < 0) return;
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, client.fd, nullptr);
+        ::close(client.fd);
+        client.fd = -1;
+        client.busy = false;
+        liveClients--;
+    }
+
+    void resetGame(Client& client) {
+        for (int i = 0; i < options.cases; i++) {
+            client.opened[i] = false;
+            client.remaining[i] = options.prizes[i];
+        }
+        client.playerCase = -1;
+        client.remainingCount = options.cases;
+    }
+
+    void forgetPrize(Client& client, int caseNumber, Cents value) {
+        if (caseNumber >= 1 && caseNumber <= options.cases) client.opened[caseNumber - 1] = true;
+        for (int i = 0; i < client.remainingCount; i++) {
+            if (client.remaining[i] == value) {
+                client.remaining[i] = client.remaining[--client.remainingCount];
+                return;
+            }
+        }
+    }
+
+    // The advisor's view of the prizes left, in dollars
+    void fillPrizeScratch(const Client& client) {
+        prizeScratch.clear();
+        for (int i = 0; i < client.remainingCount; i++) prizeScratch.push_back(toDollars(client.remaining[i]));
+    }
+
+    // Next scripted answer, or empty when the session ran out
+    std::string_view nextAnswer(Client& client) {
+        if (client.answer == client.answerEnd) return std::string_view();
+        return *client.answer++;
+    }
+
+    // Write the next command for `client` into `line`; false ends the game
+    bool nextOpen(Client& client, TextWriter& line) {
+        if (script) {
+            std::string_view answer = nextAnswer(client);
+            if (answer.empty()) return false;
+            line.put("OPEN ").put(answer);
+            return true;
+        }
+
+        int candidates[MaxVariantCases];
+        int count = 0;
+        for (int i = 0; i < options.cases; i++) {
+            if (!client.opened[i] && i != client.playerCase) candidates[count++] = i;
+        }
+        if (count == 0) return false;
+        std::uniform_int_distribution<int> pick(0, count - 1);
+        line.put("OPEN ").putInt(candidates[pick(rng)] + 1);
+        return true;
+    }
+
+    bool decide(Client& client, Cents offer, TextWriter& line) {
+        bool deal;
+        if (script) {
+            // Skip invalid answers, as the console game re-prompts for them
+            ParseResult answer;
+            do {
+                if (client.answer == client.answerEnd) return false;
+                answer = parseYesNo(nextAnswer(client));
+            } while (!answer.ok());
+            deal = answer.value == 1;
+        } else {
+            fillPrizeScratch(client);
+            deal = advisor.shouldAcceptDeal(prizeScratch, toDollars(offer), client.remainingCount);
+        }
+        line.put(deal ? "DEAL" : "NODEAL");
+        return true;
+    }
+
+    // Final swap: a scripted y/n answer (y = swap), or the advisor
+    bool decideSwap(Client& client, TextWriter& line) {
+        bool swap;
+        if (script) {
+            ParseResult answer;
+            do {
+                if (client.answer == client.answerEnd) return false;
+                answer = parseYesNo(nextAnswer(client));
+            } while (!answer.ok());
+            swap = answer.value == 1;
+        } else {
+            fillPrizeScratch(client);
+            swap = advisor.shouldSwap(prizeScratch);
+        }
+        line.put(swap ? "SWAP" : "KEEP");
+        return true;
+    }
+
+    bool chooseCase(Client& client, TextWriter& line) {
+        if (script) {
+            std::string_view answer = nextAnswer(client);
+            if (answer.empty()) return false;
+            ParseResult choice = parseInt(answer, 1, options.cases);
+            client.playerCase = choice.ok() ? choice.value - 1 : -1;
+            line.put("CASE ").put(answer);
+        } else {
+            client.playerCase = std::uniform_int_distribution<int>(0, options.cases - 1)(rng);
+            line.put("CASE ").putInt(client.playerCase + 1);
+        }
+        return true;
+    }
+
+    bool beginGame(Client& client, TextWriter& line) {
+        if (gamesStarted >= options.games) return false;
+        resetGame(client);
+        if (script) {
+            std::size_t session = static_cast<std::size_t>(gamesStarted) % script->sessionCount();
+            client.answer = script->answersBegin(session);
+            client.answerEnd = script->answersEnd(session);
+        }
+        line.put("NEW ").putUnsigned(options.seed + static_cast<std::uint64_t>(gamesStarted));
+        gamesStarted++;
+        return true;
+    }
+
+    void sendLine(Client& client, char* text, std::size_t length, Clock::time_point intended) {
+        text[length++] = '\n';
+        ssize_t sent = ::send(client.fd, text, length, MSG_NOSIGNAL);
+        if (sent != static_cast<ssize_t>(length)) {
+            // Requests are tiny and strictly one at a time, so a short write
+            // means the connection is gone
+            totals.disconnects++;
+            closeClient(client);
+            return;
+        }
+        client.busy = true;
+        client.sentAt = intended;
+    }
+
+    // Decide what `client` sends after `reply` and queue or send it
+    void advance(std::uint32_t index, std::string_view reply) {
+        Client& client = clients[index];
+        char text[64];
+        TextWriter line(text, sizeof(text) - 1);
+        std::string_view words[8];
+        std::size_t count = splitWords(reply, words, 8);
+
+        bool haveCommand = false;
+        bool gameOver = false;
+        RequestKind kind = RequestKind::Open;
+        Cents prize = 0;
+        Cents amount = 0;           // Offer or final payout; replies that garble one are errors
+
+        if (count == 0 || words[0] != "OK") {
+            totals.errors++;
+            // A rejected scripted answer moves on to the next one, like a
+            // re-prompt in the console game
+            if (script && client.pending == RequestKind::Case) {
+                haveCommand = chooseCase(client, line);
+                kind = RequestKind::Case;
+            } else if (script && client.pending == RequestKind::Open) {
+                haveCommand = nextOpen(client, line);
+            }
+            if (!haveCommand) {
+                totals.gamesFailed++;
+                gameOver = true;
+            }
+        } else if (words[1] == "NEW") {
+            haveCommand = chooseCase(client, line);
+            kind = RequestKind::Case;
+            if (!haveCommand) {
+                totals.gamesFailed++;
+                gameOver = true;
+            }
+        } else if (words[1] == "OPENED" && count >= 5 && parseCents(words[3], prize)) {
+            ParseResult number = parseInt(words[2], 1, options.cases);
+            forgetPrize(client, number.ok() ? number.value : 0, prize);
+            bool amounted = words[4] == "OFFER" || words[4] == "FINAL";
+            if (amounted && !(count >= 6 && parseCents(words[5], amount))) {
+                totals.errors++;
+            } else if (words[4] == "OFFER") {
+                haveCommand = decide(client, amount, line);
+                kind = RequestKind::Deal;
+            } else if (words[4] == "FINAL") {
+                totals.gamesCompleted++;
+                totals.winnings.add(amount);
+                gameOver = true;
+            } else {
+                haveCommand = nextOpen(client, line);
+            }
+            if (!haveCommand && !gameOver) {
+                totals.gamesFailed++;
+                gameOver = true;
+            }
+        } else if (words[1] == "CASE" || (words[1] == "NODEAL" && count >= 3 && words[2] == "ROUND")) {
+            haveCommand = nextOpen(client, line);
+            if (!haveCommand) {
+                totals.gamesFailed++;
+                gameOver = true;
+            }
+        } else if (words[1] == "DEAL" && count >= 3 && parseCents(words[2], amount)) {
+            totals.gamesCompleted++;
+            totals.deals++;
+            totals.winnings.add(amount);
+            gameOver = true;
+        } else if (words[1] == "NODEAL" && count >= 4 && words[2] == "SWAP") {
+            haveCommand = decideSwap(client, line);
+            kind = RequestKind::Deal;
+            if (!haveCommand) {
+                totals.gamesFailed++;
+                gameOver = true;
+            }
+        } else if ((words[1] == "NODEAL" || words[1] == "SWAP" || words[1] == "KEEP") && count >= 4
+                   && words[2] == "FINAL" && parseCents(words[3], amount)) {
+            totals.gamesCompleted++;
+            totals.winnings.add(amount);
+            gameOver = true;
+        } else {
+            totals.errors++;
+            totals.gamesFailed++;
+            gameOver = true;
+        }
+
+        if (gameOver) {
+            haveCommand = beginGame(client, line);
+            kind = RequestKind::New;
+            if (!haveCommand) {
+                line.put("QUIT");
+                client.quitting = true;
+                haveCommand = true;
+            }
+        }
+
+        if (!haveCommand) return;
+        client.pending = kind;
+        queueOrSend(index, text, line.size());
+    }
+
+    void queueOrSend(std::uint32_t index, char* text, std::size_t length) {
+        Client& client = clients[index];
+        if (options.rate <= 0.0) {
+            sendLine(client, text, length, Clock::now());
+            return;
+        }
+        std::memcpy(client.queued, text, length);
+        client.queuedLength = length;
+        markReady(index);
+    }
+
+    // Send queued commands whose slots are due; returns ms until the next slot
+    int releaseSlots() {
+        if (readyCount == 0) return -1;
+        Clock::time_point now = Clock::now();
+        while (readyCount > 0 && nextSlot <= now) {
+            std::uint32_t index = readyQueue[readyHead];
+            readyHead = (readyHead + 1) % readyQueue.size();
+            readyCount--;
+            Client& client = clients[index];
+            if (client.fd < 0) continue;
+            // Latency counts from the scheduled slot, so a server that falls
+            // behind the target rate is charged for the queueing it causes
+            sendLine(client, client.queued, client.queuedLength, nextSlot);
+            nextSlot += slotInterval;
+        }
+        if (readyCount == 0) return -1;
+        auto wait = std::chrono::duration_cast<std::chrono::milliseconds>(nextSlot - now).count();
+        return static_cast<int>(std::max<long long>(wait, 0));
+    }
+
+    void onReadable(std::uint32_t index) {
+        Client& client = clients[index];
+        const std::size_t bufferSize = sizeof(client.in);
+        while (client.fd >= 0) {
+            ssize_t received = ::recv(client.fd, client.in + client.inLength, bufferSize - client.inLength, 0);
+            if (received < 0) {
+                if (errno == EINTR) continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK) return;
+            }
+            if (received <= 0) {
+                if (!client.quitting) totals.disconnects++;
+                closeClient(client);
+                return;
+            }
+            client.inLength += static_cast<std::size_t>(received);
+
+            char* newline = static_cast<char*>(std::memchr(client.in, '\n', client.inLength));
+            if (!newline) {
+                if (client.inLength == bufferSize) {
+                    totals.errors++;
+                    closeClient(client);
+                }
+                continue;
+            }
+
+            std::string_view reply(client.in, static_cast<std::size_t>(newline - client.in));
+            if (!client.busy) {
+                // Unsolicited line: the server refused the connection
+                if (reply == "ERR server full") totals.rejected++;
+                else totals.errors++;
+                closeClient(client);
+                return;
+            }
+
+            Clock::time_point now = Clock::now();
+            RequestKind kind = client.pending;
+            if (client.quitting) {
+                closeClient(client);
+                return;
+            }
+            if (kind == RequestKind::Open && reply.find(" OFFER ") != std::string_view::npos) kind = RequestKind::Offer;
+            latency[static_cast<int>(kind)].record(static_cast<std::uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(now - client.sentAt).count()));
+            client.busy = false;
+
+            // The reply is parsed in place before the buffer is compacted
+            advance(index, reply);
+            std::size_t consumed = static_cast<std::size_t>(newline - client.in) + 1;
+            std::memmove(client.in, client.in + consumed, client.inLength - consumed);
+            client.inLength -= consumed;
+        }
+    }
+
+    void writeLatency(FrameBuffer& json, const LatencyHistogram& histogram) {
+        auto micros = [](std::uint64_t nanoseconds) { return static_cast<double>(nanoseconds) / 1000.0; };
+        json.put("{\"count\": ").putUnsigned(histogram.count());
+        json.put(", \"mean\": ").putFixed(histogram.mean() / 1000.0, 1);
+        json.put(", \"p50\": ").putFixed(micros(histogram.percentile(0.50)), 1);
+        json.put(", \"p90\": ").putFixed(micros(histogram.percentile(0.90)), 1);
+        json.put(", \"p99\": ").putFixed(micros(histogram.percentile(0.99)), 1);
+        json.put(", \"p999\": ").putFixed(micros(histogram.percentile(0.999)), 1);
+        json.put(", \"max\": ").putFixed(micros(histogram.max()), 1).put('}');
+    }
+
+    static void putJsonString(FrameBuffer& json, std::string_view text) {
+        json.put('"');
+        for (char ch : text) {
+            if (ch == '"' || ch == '\\') json.put('\\');
+            json.put(ch);
+        }
+        json.put('"');
+    }
+
+public:
+    LoadGenerator(const LoadOptions& loadOptions, ScriptInput* scriptInput)
+        : options(loadOptions), script(scriptInput), advisor(ComputerPlayer::shared()), rng(loadOptions.seed), gamesStarted(0),
+          epollFd(-1), liveClients(0), readyHead(0), readyCount(0) {
+        prizeScratch.reserve(MaxVariantCases);
+    }
+
+    ~LoadGenerator() {
+        for (Client& client : clients) {
+            if (client.fd >= 0) ::close(client.fd);
+        }
+        if (epollFd >= 0) ::close(epollFd);
+    }
+
+    // Connect every client and play until the games or the time run out
+    bool run() {
+        std::signal(SIGPIPE, SIG_IGN);
+        epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        if (epollFd < 0) return false;
+
+        clients.resize(static_cast<std::size_t>(options.connections));
+        readyQueue.resize(clients.size());
+        if (options.rate > 0.0) {
+            slotInterval = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / options.rate));
+        }
+
+        for (std::size_t i = 0; i < clients.size(); i++) {
+            Client& client = clients[i];
+            client.fd = connectEndpoint(options.endpoint);
+            if (client.fd < 0) {
+                if (i == 0) return false;
+                totals.rejected++;
+                continue;
+            }
+            epoll_event event;
+            event.events = EPOLLIN | EPOLLRDHUP;
+            event.data.u64 = i;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, client.fd, &event);
+            liveClients++;
+        }
+
+        Clock::time_point start = Clock::now();
+        nextSlot = start;
+        for (std::size_t i = 0; i < clients.size(); i++) {
+            if (clients[i].fd < 0) continue;
+            char text[64];
+            TextWriter line(text, sizeof(text) - 1);
+            if (!beginGame(clients[i], line)) {
+                line.put("QUIT");
+                clients[i].quitting = true;
+            }
+            clients[i].pending = RequestKind::New;
+            queueOrSend(static_cast<std::uint32_t>(i), text, line.size());
+        }
+
+        Clock::time_point deadline = options.duration > 0.0
+            ? start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(options.duration))
+            : Clock::time_point::max();
+
+        epoll_event events[256];
+        while (liveClients > 0) {
+            int timeout = releaseSlots();
+            Clock::time_point now = Clock::now();
+            if (now >= deadline) break;
+            if (deadline != Clock::time_point::max()) {
+                auto left = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+                if (timeout < 0 || left < timeout) timeout = static_cast<int>(left);
+            }
+
+            int ready = ::epoll_wait(epollFd, events, 256, timeout);
+            if (ready < 0) {
+                if (errno == EINTR) continue;
+                break;
+            }
+            for (int i = 0; i < ready; i++) {
+                onReadable(static_cast<std::uint32_t>(events[i].data.u64));
+            }
+        }
+
+        totals.seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        return true;
+    }
+
+    void writeReport(FrameBuffer& json) {
+        std::uint64_t requests = 0;
+        for (const LatencyHistogram& histogram : latency) requests += histogram.count();
+
+        json.put("{\n  \"endpoint\": ");
+        putJsonString(json, options.endpoint);
+        json.put(",\n  \"mode\": ").put(script ? "\"script\"" : "\"computer\"");
+        json.put(",\n  \"variant\": ");
+        putJsonString(json, options.variant);
+        json.put(",\n  \"connections\": ").putInt(options.connections);
+        json.put(",\n  \"target_rate\": ").putFixed(options.rate, 1);
+        json.put(",\n  \"seconds\": ").putFixed(totals.seconds, 3);
+        json.put(",\n  \"requests\": ").putUnsigned(requests);
+        json.put(",\n  \"requests_per_second\": ").putFixed(totals.seconds > 0 ? requests / totals.seconds : 0.0, 1);
+        json.put(",\n  \"games_completed\": ").putInt(totals.gamesCompleted);
+        json.put(",\n  \"games_failed\": ").putInt(totals.gamesFailed);
+        json.put(",\n  \"deals\": ").putInt(totals.deals);
+        json.put(",\n  \"average_winnings\": ").putFixed(
+            totals.gamesCompleted > 0 ? totals.winnings.dollars() / totals.gamesCompleted : 0.0, 2);
+        json.put(",\n  \"errors\": ").putInt(totals.errors);
+        json.put(",\n  \"rejected_connections\": ").putInt(totals.rejected);
+        json.put(",\n  \"disconnects\": ").putInt(totals.disconnects);
+        json.put(",\n  \"latency_us\": {");
+        for (int kind = 0; kind < static_cast<int>(RequestKind::Count); kind++) {
+            json.put(kind == 0 ? "\n    \"" : ",\n    \"").put(RequestNames[kind]).put("\": ");
+            writeLatency(json, latency[kind]);
+        }
+        json.put("\n  }\n}\n");
+        json.flush();
+    }
+};
+
+std::string loadScript(const std::string& path) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) return std::string();
+    std::ostringstream text;
+    text << file.rdbuf();
+    return text.str();
+}
+
+void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " --connect ENDPOINT [options]\n"
+              << "  --connect EP      server endpoint, unix:/path or tcp:[host:]port\n"
+              << "  --connections N   concurrent connections (default 100)\n"
+              << "  --games N         total games to play (default 1000)\n"
+              << "  --rate R          target requests per second across all connections (default unpaced)\n"
+              << "  --duration S      stop after S seconds\n"
+              << "  --script FILE     play batch-mode script sessions instead of the computer player\n"
+              << "  --seed S          game seed base; game i is dealt with seed S + i (default 1)\n"
+              << "  --variant NAME    show format the server runs (default standard)\n"
+              << "  --variant-file F  variant file the server was started with\n"
+              << "  --output FILE     write the JSON report to FILE instead of stdout\n";
+}
+
+} // namespace
+
+int main(int argc, char* argv[]) {
+    LoadOptions options;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        bool valid = true;
+        if (arg == "--connect" && hasValue) {
+            options.endpoint = argv[++i];
+        } else if (arg == "--connections" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, 1000000);
+            valid = value.ok();
+            options.connections = value.value;
+        } else if (arg == "--games" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            valid = value.ok();
+            options.games = value.value;
+        } else if (arg == "--rate" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            valid = value.ok();
+            options.rate = value.value;
+        } else if (arg == "--duration" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, 86400);
+            valid = value.ok();
+            options.duration = value.value;
+        } else if (arg == "--seed" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 0, std::numeric_limits<int>::max());
+            valid = value.ok();
+            options.seed = static_cast<std::uint64_t>(value.value);
+        } else if (arg == "--script" && hasValue) {
+            options.scriptPath = argv[++i];
+        } else if (arg == "--variant" && hasValue) {
+            options.variant = argv[++i];
+            valid = withVariant(options.variant, [&options](auto variant) {
+                using Variant = decltype(variant);
+                options.cases = Variant::Cases;
+                options.prizes = boardValues(BuiltinRules<Variant>.board);
+            });
+        } else if (arg == "--variant-file" && hasValue) {
+            VariantSpec spec;
+            std::string error;
+            if (!loadVariantFile(argv[++i], spec, error)) {
+                std::cerr << "Invalid variant file: " << error << std::endl;
+                return 1;
+            }
+            options.variant = spec.name;
+            options.cases = static_cast<int>(spec.prizes.size());
+            options.prizes.clear();
+            for (double prize : spec.prizes) options.prizes.push_back(toCents(prize));
+        } else if (arg == "--output" && hasValue) {
+            options.outputPath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+        if (!valid) {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (options.endpoint.empty()) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    std::unique_ptr<ScriptInput> script;
+    if (!options.scriptPath.empty()) {
+        std::string text = loadScript(options.scriptPath);
+        script = std::make_unique<ScriptInput>(std::move(text));
+        if (script->sessionCount() == 0) {
+            std::cout << "No sessions in script: " << options.scriptPath << std::endl;
+            return 1;
+        }
+    }
+
+    int outputFd = 1;
+    if (!options.outputPath.empty()) {
+        outputFd = ::open(options.outputPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (outputFd < 0) {
+            std::cout << "Cannot open output file: " << options.outputPath << std::endl;
+            return 1;
+        }
+    }
+
+    LoadGenerator generator(options, script.get());
+    if (!generator.run()) {
+        std::cout << "Cannot connect to " << options.endpoint << ": " << std::strerror(errno) << std::endl;
+        return 1;
+    }
+
+    FrameBuffer json(outputFd);
+    generator.writeReport(json);
+    if (outputFd != 1) ::close(outputFd);
+    return 0;
+}
+
+#endif // __linux__
@@ -0,0 +1,261 @@
+#ifndef DEALMASTER_LOOKAHEAD_H
+#define DEALMASTER_LOOKAHEAD_H
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "bit_ops.h"
+#include "bank_model.h"
+#include "game_variants.h"
+#include "money.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+// Exact risk-neutral values of one position of a game (the prizes still in
+// play, the player's case among them) and of every position below it: the
+// expected payout of playing on optimally, taking any offer worth more than
+// refusing it. One pass up over the subsets of the root in numeric order,
+// like the analyzer's optimal values but local to the game being played, so
+// a root of k prizes costs 2^k values instead of the whole board's.
+template <class Variant>
+class LookaheadTable {
+public:
+    static constexpr int Cases = Variant::Cases;
+    using Mask = CaseMask<Cases>;
+    using Rules = BasicGameRules<Cases>;
+
+    // Largest root: 2^21 values, 16 MB and a fraction of a second
+    static constexpr int MaxRootPrizes = Cases < 21 ? Cases : 21;
+
+private:
+    static constexpr int HalfBits = (MaxRootPrizes + 1) / 2;
+
+    Mask root = 0;
+    int prizes = 0;
+    int lowBits = 0;
+    int finalPrizes = 0;                    // Prizes in play at the last offer
+    int offerRound[Cases + 1] = {};         // Round whose offer is made with k prizes in play, or 0
+    int localBit[Cases] = {};               // Bit of each board prize in local masks, or -1
+    std::vector<Mask> lowMask;              // Board mask of the low and high halves of a local mask
+    std::vector<Mask> highMask;
+    std::vector<Cents> lowSum;              // ...and the sum of their prizes
+    std::vector<Cents> highSum;
+    std::vector<double> values;             // Optimal expected payout by local mask, at its offer
+
+    std::uint32_t local(Mask position) const {
+        std::uint32_t result = 0;
+        for (int i = 0; i < Cases; i++) {
+            if ((position >> i) & 1u) result |= 1u << localBit[i];
+        }
+        return result;
+    }
+
+    double mean(std::uint32_t mask) const {
+        int count = popcount32(mask);
+        if (count == 0) return 0.0;
+        Cents sum = lowSum[mask & ((1u << lowBits) - 1)] + highSum[mask >> lowBits];
+        return toDollars(sum) / count;
+    }
+
+    // Expected payout of refusing the offer at `mask` (or of opening the
+    // next case between offers): the player's case is equally likely to be
+    // any prize left after the last offer, and before it each case opened
+    // takes out each prize equally often
+    double later(std::uint32_t mask) const {
+        int bits = popcount32(mask);
+        if (bits <= finalPrizes) return mean(mask);
+        double sum = 0.0;
+        for (std::uint32_t rest = mask; rest != 0; rest &= rest - 1) {
+            sum += values[mask ^ (rest & (~rest + 1))];
+        }
+        return sum / bits;
+    }
+
+public:
+    LookaheadTable()
+        : lowMask(std::size_t(1) << HalfBits), highMask(std::size_t(1) << HalfBits),
+          lowSum(std::size_t(1) << HalfBits), highSum(std::size_t(1) << HalfBits) {}
+
+    // Values of `position` and every position below it; false if `cancel`
+    // was raised first or the position has more than MaxRootPrizes prizes
+    bool compute(const Rules& rules, const BasicBankModel<Cases>& bank, Mask position,
+                 const std::atomic<bool>& cancel) {
+        trace::Span span("lookahead", "advisor", "prizes", popcount32(position));
+        root = 0;
+        prizes = popcount32(position);
+        if (prizes > MaxRootPrizes) return false;
+
+        std::fill(std::begin(offerRound), std::end(offerRound), 0);
+        // The game makes no offer once a single prize is left
+        int left = Cases;
+        finalPrizes = 1;
+        for (int r = 0; r < rules.rounds; r++) {
+            left -= rules.casesPerRound[r];
+            if (left < 2) break;
+            offerRound[left] = r + 1;
+            finalPrizes = left;
+        }
+
+        int board[Cases];
+        int count = 0;
+        for (int i = 0; i < Cases; i++) {
+            localBit[i] = -1;
+            if ((position >> i) & 1u) {
+                localBit[i] = count;
+                board[count++] = i;
+            }
+        }
+        lowBits = std::min(prizes, HalfBits);
+        std::size_t highSize = std::size_t(1) << (prizes - lowBits);
+        for (std::size_t half = 1; half < (std::size_t(1) << lowBits); half++) {
+            int j = countTrailingZeros(half);
+            lowMask[half] = static_cast<Mask>(lowMask[half & (half - 1)] | (1u << board[j]));
+            lowSum[half] = lowSum[half & (half - 1)] + rules.board.cents[board[j]];
+        }
+        for (std::size_t half = 1; half < highSize; half++) {
+            int j = lowBits + countTrailingZeros(half);
+            highMask[half] = static_cast<Mask>(highMask[half & (half - 1)] | (1u << board[j]));
+            highSum[half] = highSum[half & (half - 1)] + rules.board.cents[board[j]];
+        }
+
+        // Grows to the largest root once; later games reuse the buffer
+        std::uint32_t size = 1u << prizes;
+        values.resize(size);
+        for (std::uint32_t mask = 0; mask < size; mask++) {
+            if ((mask & 0xfff) == 0 && cancel.load(std::memory_order_relaxed)) return false;
+            int bits = popcount32(mask);
+            if (bits < finalPrizes) continue;
+            double value = later(mask);
+            int round = offerRound[bits];
+            if (round != 0) {
+                Mask set = static_cast<Mask>(lowMask[mask & ((1u << lowBits) - 1)] | highMask[mask >> lowBits]);
+                value = std::max(value, toDollars(bank.offer(rules, round, set)));
+            }
+            values[mask] = value;
+        }
+        root = position;
+        return true;
+    }
+
+    // Every position reachable from the root is below it
+    bool covers(Mask position) const {
+        return root != 0 && (position & ~root) == 0;
+    }
+
+    // Expected payout of `position` with optimal play, at its offer
+    double optimalValue(Mask position) const {
+        return values[local(position)];
+    }
+
+    // Expected payout of refusing the offer at `position` and playing on
+    // optimally
+    double playOnValue(Mask position) const {
+        return later(local(position));
+    }
+
+    // The perfect-play verdict on `offer` at `position`, as advisor lines
+    // (`out` is a FrameBuffer or TextWriter)
+    template <class Writer>
+    void writeAdvice(Writer& out, Mask position, double offer) const {
+        double playOn = playOnValue(position);
+        out.put("Value of NO DEAL with perfect play: $").putFixed(playOn, 2).put('\n');
+        out.put(offer >= playOn ? "PERFECT PLAY: DEAL\n" : "PERFECT PLAY: NO DEAL\n");
+    }
+};
+
+// Computes a LookaheadTable on a background thread while the console waits
+// for the player. The game posts the position every time it blocks on
+// input; the worker starts only if the current table does not already cover
+// it, so one root (the first small enough, late in the first round) serves
+// every later prompt of the game. At the offer the game waits for the table,
+// which is normally long done. One worker per console; the thread starts on
+// the first request.
+template <class Variant>
+class LookaheadWorker {
+public:
+    static constexpr int Cases = Variant::Cases;
+    using Mask = CaseMask<Cases>;
+    using Rules = BasicGameRules<Cases>;
+    using Table = LookaheadTable<Variant>;
+
+private:
+    const Rules& rules;
+    const BasicBankModel<Cases>& bank;
+    Table table;
+    std::thread thread;
+    std::mutex mutex;
+    std::condition_variable changed;
+    std::atomic<bool> cancel{false};
+    Mask requested = 0;                     // Root of the last request
+    bool pending = false;                   // ...not picked up by the worker yet
+    bool busy = false;                      // The worker is computing
+    bool ready = false;                     // `table` holds the values below `requested`
+    bool stopping = false;
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (true) {
+            changed.wait(lock, [&]() { return pending || stopping; });
+            if (stopping) return;
+            Mask position = requested;
+            pending = false;
+            busy = true;
+            cancel.store(false, std::memory_order_relaxed);
+            lock.unlock();
+            bool done = table.compute(rules, bank, position, cancel);
+            lock.lock();
+            busy = false;
+            ready = done && !pending;
+            changed.notify_all();
+        }
+    }
+
+public:
+    LookaheadWorker(const Rules& gameRules, const BasicBankModel<Cases>& bankModel)
+        : rules(gameRules), bank(bankModel) {}
+
+    LookaheadWorker(const LookaheadWorker&) = delete;
+    LookaheadWorker& operator=(const LookaheadWorker&) = delete;
+
+    ~LookaheadWorker() {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+            cancel.store(true, std::memory_order_relaxed);
+        }
+        changed.notify_all();
+        if (thread.joinable()) thread.join();
+    }
+
+    // Start on the positions below `position` unless they are already
+    // computed or being computed; positions too large to tabulate are skipped
+    void speculate(Mask position) {
+        if (popcount32(position) > Table::MaxRootPrizes) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if ((ready || pending || busy) && (position & ~requested) == 0) return;
+            requested = position;
+            pending = true;
+            ready = false;
+            if (busy) cancel.store(true, std::memory_order_relaxed);
+            if (!thread.joinable()) thread = std::thread(&LookaheadWorker::run, this);
+        }
+        changed.notify_all();
+    }
+
+    // The table covering `position`, once the worker has finished it, or
+    // nullptr if no request covers it
+    const Table* wait(Mask position) {
+        std::unique_lock<std::mutex> lock(mutex);
+        if (!(ready || pending || busy) || (position & ~requested) != 0) return nullptr;
+        changed.wait(lock, [&]() { return ready || (!pending && !busy); });
+        return ready ? &table : nullptr;
+    }
+};
+
+#endif // DEALMASTER_LOOKAHEAD_H
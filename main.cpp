@@ -1,7 +1,6 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <random>
 #include <iomanip>
 #include <string>
 #include <map>
@@ -11,6 +10,39 @@
 #include <limits>
 #include <sstream>
 #include <fstream>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <string_view>
+#include <charconv>
+#include <thread>
+#include <atomic>
+#include <cstdlib>
+#include <new>
+
+#include "alloc_hooks.h"
+#include "frame_buffer.h"
+#include "input_parser.h"
+#include "input_source.h"
+#include "replay_log.h"
+#include "compact_record.h"
+#include "game_rules.h"
+#include "game_variants.h"
+#include "prize_board.h"
+#include "money.h"
+#include "variant_rules.h"
+#include "bank_model.h"
+#include "simulator.h"
+#include "bank_solver.h"
+#include "player_policy.h"
+#include "position_analyzer.h"
+#include "lookahead.h"
+#include "offer_preview.h"
+#include "computer_player.h"
+#include "instrumentation.h"
+#include "metrics.h"
+#include "trace_events.h"
+#include "game_server.h"
 
 // Custom exception classes for better error handling
 class GameException : public std::exception {
@@ -37,365 +69,339 @@ public:
 struct GameStats {
     int gamesPlayed = 0;
     int gamesWon = 0;
-    double totalWinnings = 0.0;
-    double bestWinning = 0.0;
+    CentsTotal totalWinnings;           // Exact over any number of games
+    Cents bestWinning = 0;
     double averageWinning = 0.0;
     
-    void updateStats(double winnings) {
+    void updateStats(Cents winnings) {
         gamesPlayed++;
-        totalWinnings += winnings;
+        totalWinnings.add(winnings);
         if (winnings > bestWinning) {
             bestWinning = winnings;
         }
-        averageWinning = totalWinnings / gamesPlayed;
+        averageWinning = totalWinnings.dollars() / gamesPlayed;
         if (winnings > 0) {
             gamesWon++;
         }
     }
     
-    void displayStats() const {
-        std::cout << "\n=== GAME STATISTICS ===\n";
-        std::cout << "Games Played: " << gamesPlayed << std::endl;
-        std::cout << "Games Won: " << gamesWon << std::endl;
-        std::cout << "Win Rate: " << std::fixed << std::setprecision(1) 
-                  << (gamesPlayed > 0 ? (double)gamesWon / gamesPlayed * 100 : 0) << "%" << std::endl;
-        std::cout << "Total Winnings: $" << std::fixed << std::setprecision(2) << totalWinnings << std::endl;
-        std::cout << "Best Winning: $" << std::fixed << std::setprecision(2) << bestWinning << std::endl;
-        std::cout << "Average Winning: $" << std::fixed << std::setprecision(2) << averageWinning << std::endl;
+    void displayStats(FrameBuffer& out) const {
+        out.put("\n=== GAME STATISTICS ===\n");
+        out.put("Games Played: ").putInt(gamesPlayed).newline();
+        out.put("Games Won: ").putInt(gamesWon).newline();
+        out.put("Win Rate: ")
+           .putFixed(gamesPlayed > 0 ? (double)gamesWon / gamesPlayed * 100 : 0, 1).put("%\n");
+        char total[44];
+        out.put("Total Winnings: $").put(totalWinnings.format(total)).newline();
+        out.put("Best Winning: ").putMoney(bestWinning).newline();
+        out.put("Average Winning: ").putMoney(averageWinning).newline();
     }
 };
 
-// Advanced AI Computer Player
-class ComputerPlayer {
-private:
-    std::mt19937 rng;
-    
-    // Calculate expected value of remaining cases
-    double calculateExpectedValue(const std::vector<double>& remainingPrizes) const {
-        if (remainingPrizes.empty()) return 0.0;
-        
-        double sum = 0.0;
-        for (double prize : remainingPrizes) {
-            sum += prize;
-        }
-        return sum / remainingPrizes.size();
-    }
-    
-    // Calculate standard deviation for risk assessment
-    double calculateStandardDeviation(const std::vector<double>& remainingPrizes) const {
-        if (remainingPrizes.size() <= 1) return 0.0;
-        
-        double mean = calculateExpectedValue(remainingPrizes);
-        double variance = 0.0;
-        
-        for (double prize : remainingPrizes) {
-            variance += (prize - mean) * (prize - mean);
-        }
-        variance /= remainingPrizes.size();
-        
-        return std::sqrt(variance);
-    }
-    
-    // Calculate risk-adjusted decision factor
-    double calculateRiskFactor(const std::vector<double>& remainingPrizes, double bankOffer) const {
-        double expectedValue = calculateExpectedValue(remainingPrizes);
-        double stdDev = calculateStandardDeviation(remainingPrizes);
-        
-        // Risk adjustment based on variance
-        double riskAdjustment = stdDev / (expectedValue + 1.0);
-        
-        // Calculate probability of getting better than bank offer
-        int betterCount = 0;
-        for (double prize : remainingPrizes) {
-            if (prize > bankOffer) betterCount++;
-        }
-        double probBetter = (double)betterCount / remainingPrizes.size();
-        
-        return probBetter - riskAdjustment * 0.3; // Conservative approach
-    }
-
-public:
-    ComputerPlayer() : rng(std::chrono::steady_clock::now().time_since_epoch().count()) {}
-    
-    // Make optimal decision for computer player
-    bool shouldAcceptDeal(const std::vector<double>& remainingPrizes, double bankOffer, int casesRemaining) const {
-        if (remainingPrizes.empty()) return true;
-        
-        double expectedValue = calculateExpectedValue(remainingPrizes);
-        
-        // Early game strategy (more cases remaining)
-        if (casesRemaining > 10) {
-            return bankOffer >= expectedValue * 0.9; // Conservative early on
-        }
-        // Mid game strategy
-        else if (casesRemaining > 5) {
-            return bankOffer >= expectedValue * 0.85; // More aggressive
-        }
-        // End game strategy
-        else {
-            double riskFactor = calculateRiskFactor(remainingPrizes, bankOffer);
-            return riskFactor < 0.4 || bankOffer >= expectedValue * 0.8;
-        }
-    }
-    
-    // Provide advice to human player
-    std::string getAdvice(const std::vector<double>& remainingPrizes, double bankOffer, int casesRemaining) const {
-        if (remainingPrizes.empty()) return "Accept the deal!";
-        
-        double expectedValue = calculateExpectedValue(remainingPrizes);
-        double stdDev = calculateStandardDeviation(remainingPrizes);
-        double riskFactor = calculateRiskFactor(remainingPrizes, bankOffer);
-        
-        std::stringstream advice;
-        advice << "\n=== AI ADVISOR ===\n";
-        advice << "Expected Value: $" << std::fixed << std::setprecision(2) << expectedValue << std::endl;
-        advice << "Bank Offer: $" << std::fixed << std::setprecision(2) << bankOffer << std::endl;
-        advice << "Offer vs Expected: " << std::fixed << std::setprecision(1) 
-               << (bankOffer / expectedValue * 100) << "%" << std::endl;
-        advice << "Risk Level: " << std::fixed << std::setprecision(1) 
-               << (stdDev / expectedValue * 100) << "%" << std::endl;
-        
-        if (shouldAcceptDeal(remainingPrizes, bankOffer, casesRemaining)) {
-            advice << "RECOMMENDATION: DEAL! The offer is favorable.\n";
-        } else {
-            advice << "RECOMMENDATION: NO DEAL! You can likely do better.\n";
-        }
-        
-        return advice.str();
-    }
-    
-    // Select cases to open (for computer player)
-    std::vector<int> selectCasesToOpen(const std::vector<bool>& casesOpened, int numToOpen) {
-        std::vector<int> availableCases;
-        for (int i = 0; i < casesOpened.size(); i++) {
-            if (!casesOpened[i]) {
-                availableCases.push_back(i);
-            }
-        }
-        
-        std::shuffle(availableCases.begin(), availableCases.end(), rng);
-        
-        std::vector<int> selectedCases;
-        for (int i = 0; i < std::min(numToOpen, (int)availableCases.size()); i++) {
-            selectedCases.push_back(availableCases[i]);
-        }
-        
-        return selectedCases;
-    }
+// Result of the most recent game, used by batch mode reporting
+struct GameOutcome {
+    bool completed = false;
+    bool tookDeal = false;
+    bool swapped = false;
+    int playerCase = -1;
+    int finalRound = 0;
+    Cents winnings = 0;
+    Cents caseValue = 0;
 };
 
-// Main Game Class
+// Main Game Class, compiled once per board size (see game_variants.h) and
+// driven by the prize, schedule and offer tables of its rules
+template <class Variant>
 class DealOrNoDealGame {
 private:
-    std::vector<double> allPrizes;
-    std::vector<double> caseValues;
-    std::vector<bool> casesOpened;
-    std::vector<double> remainingPrizes;
-    std::mt19937 rng;
+    static constexpr int Cases = Variant::Cases;
+    using Rules = BasicGameRules<Cases>;
+    using BankModel = BasicBankModel<Cases>;
+    using Board = BasicPrizeBoard<Cases>;
+    using Mask = typename Board::Mask;
+    
+    FrameBuffer& out;
+    InputSource& input;
+    const Rules& rules;
+    const BankModel& bank;
+    const Board& board;
+    std::uint8_t casePrize[Cases];          // Prize index (into board) held by each case
+    BasicPrizeRanks<Cases> remaining;       // Prizes still in play, the player's case among them
+    Mask openedMask;                        // Bit per opened case
+    std::uint64_t rngState;                 // SplitMix64 state of the computer's picks and unseeded shuffles
+    std::uint64_t fixedSeed;                // Shuffle seed of the next game, if seedGiven
+    bool seedGiven;
     int playerCase;
     int round;
-    double finalWinning;
+    Cents finalWinning;
+    bool persistStats;
     GameStats stats;
-    std::unique_ptr<ComputerPlayer> aiPlayer;
-    
-    // Initialize prize values
-    void initializePrizes() {
-        allPrizes = {
-            0.01, 1.0, 5.0, 10.0, 25.0, 50.0, 75.0, 100.0, 200.0, 300.0,
-            400.0, 500.0, 750.0, 1000.0, 5000.0, 10000.0, 25000.0, 50000.0,
-            75000.0, 100000.0, 200000.0, 300000.0, 400000.0, 500000.0, 750000.0, 1000000.0
-        };
-        
-        if (allPrizes.size() != 26) {
-            throw GameStateException("Invalid number of prizes initialized");
-        }
+    GameOutcome outcome;
+    replay::GameLog gameLog;
+    replay::ReplayWriter* recorder;
+    LookaheadWorker<Variant>* lookahead;
+    const ComputerPlayer& aiPlayer;
+    
+    Cents caseValue(int caseIndex) const {
+        return board.cents[casePrize[caseIndex]];
     }
     
-    // Shuffle and assign prizes to cases
-    void shufflePrizes() {
-        caseValues = allPrizes;
-        std::shuffle(caseValues.begin(), caseValues.end(), rng);
-        casesOpened.assign(26, false);
-        updateRemainingPrizes();
+    bool isOpened(int caseIndex) const {
+        return (openedMask >> caseIndex) & 1u;
     }
     
-    // Update remaining prizes list
-    void updateRemainingPrizes() {
-        remainingPrizes.clear();
-        for (int i = 0; i < 26; i++) {
-            if (!casesOpened[i]) {
-                remainingPrizes.push_back(caseValues[i]);
-            }
+    // Shuffle and assign prizes to cases. The layout is derived from a
+    // per-game seed with a portable shuffle so that replays can rebuild it.
+    std::uint64_t shufflePrizes() {
+        std::uint64_t gameSeed;
+        {
+            instrument::ScopedPhase timer(instrument::Phase::Shuffle);
+            gameSeed = seedGiven ? fixedSeed : replay::splitMix64(rngState);
+            seedGiven = false;
+            for (int i = 0; i < Cases; i++) casePrize[i] = static_cast<std::uint8_t>(i);
+            replay::shuffleWithSeed(gameSeed, casePrize, Cases);
+            openedMask = 0;
         }
-        std::sort(remainingPrizes.rbegin(), remainingPrizes.rend());
+        {
+            instrument::ScopedPhase timer(instrument::Phase::UpdateRemaining);
+            remaining.reset(board.allMask);
+        }
+        return gameSeed;
     }
     
     // Calculate bank offer
-    double calculateBankOffer() const {
-        if (remainingPrizes.empty()) return 0.0;
-        
-        double sum = 0.0;
-        for (double prize : remainingPrizes) {
-            sum += prize;
-        }
-        
-        double averageValue = sum / remainingPrizes.size();
-        
-        // Progressive offer percentage based on round
-        double offerPercentage = 0.1 + (round * 0.05);
-        if (offerPercentage > 0.9) offerPercentage = 0.9;
-        
-        return averageValue * offerPercentage;
+    Cents calculateBankOffer() const {
+        instrument::ScopedPhase timer(instrument::Phase::Offer);
+        return bank.offer(rules, round, remaining.inPlay());
     }
     
     // Display game board
     void displayBoard() const {
-        std::cout << "\n=== DEAL OR NO DEAL - ROUND " << round << " ===\n";
-        std::cout << "Your Case: " << (playerCase + 1) << std::endl;
-        std::cout << "\nCases Status:\n";
+        instrument::ScopedPhase timer(instrument::Phase::Render);
+        out.put("\n=== DEAL OR NO DEAL - ROUND ").putInt(round).put(" ===\n");
+        out.put("Your Case: ").putInt(playerCase + 1).newline();
+        out.put("\nCases Status:\n");
         
-        for (int i = 0; i < 26; i++) {
+        for (int i = 0; i < Cases; i++) {
             if (i == playerCase) {
-                std::cout << "[" << std::setw(2) << (i + 1) << "]";
-            } else if (casesOpened[i]) {
-                std::cout << " XX ";
+                out.put('[').putInt(i + 1, 2).put(']');
+            } else if (isOpened(i)) {
+                out.put(" XX ");
             } else {
-                std::cout << " " << std::setw(2) << (i + 1) << " ";
+                out.put(' ').putInt(i + 1, 2).put(' ');
             }
             
-            if ((i + 1) % 13 == 0) std::cout << std::endl;
+            if ((i + 1) % rules.columns == 0) out.newline();
         }
         
-        std::cout << "\nRemaining Prizes:\n";
+        out.put("\nRemaining Prizes:\n");
         displayRemainingPrizes();
     }
     
     // Display remaining prizes in a formatted way
     void displayRemainingPrizes() const {
-        std::cout << "Low Prizes: ";
-        for (int i = remainingPrizes.size() - 1; i >= 0; i--) {
-            if (remainingPrizes[i] <= 500) {
-                std::cout << "$" << std::fixed << std::setprecision(2) << remainingPrizes[i] << " ";
+        out.put("Low Prizes: ");
+        for (int i = 0; i < board.lowCount; i++) {
+            if ((remaining.inPlay() >> i) & 1u) {
+                out.putMoney(board.value[i]).put(' ');
             }
         }
-        std::cout << "\n";
+        out.newline();
         
-        std::cout << "High Prizes: ";
-        for (double prize : remainingPrizes) {
-            if (prize > 500) {
-                std::cout << "$" << std::fixed << std::setprecision(0) << prize << " ";
+        out.put("High Prizes: ");
+        for (int i = Cases - 1; i >= board.lowCount; i--) {
+            if ((remaining.inPlay() >> i) & 1u) {
+                out.putMoney(board.value[i], 0).put(' ');
             }
         }
-        std::cout << "\n";
+        out.newline();
+    }
+    
+    // Banner framing the bank offer
+    void displayOffer(Cents bankOffer) const {
+        instrument::ScopedPhase timer(instrument::Phase::Render);
+        out.newline().repeat('=', 50).newline();
+        out.put("THE BANK OFFERS: ").putMoney(bankOffer).newline();
+        out.repeat('=', 50).newline();
+    }
+    
+    // Hand the lookahead worker the prizes still in play once the cases
+    // in `chosen` are opened, so it works while the player thinks
+    void speculate(const int* chosen, int count) {
+        if (!lookahead) return;
+        Mask position = remaining.inPlay();
+        for (int i = 0; i < count; i++) {
+            position = static_cast<Mask>(position & ~(1u << casePrize[chosen[i]]));
+        }
+        lookahead->speculate(position);
+    }
+    
+    // Spread of the offer of `offerRound`, made once `casesToOpen` more
+    // cases are opened, against `current` (0 before the first offer)
+    void displayOfferPreview(int offerRound, int casesToOpen, Cents current) const {
+        OfferPreview preview;
+        if (previewNextOffer(rules, bank, offerRound, remaining.inPlay(), casesToOpen, current, preview)) {
+            writeOfferPreview(out, preview);
+        }
+    }
+    
+    // Read one line of player input
+    std::string_view readInputLine() {
+        std::string_view line;
+        if (!input.readLine(line)) {
+            throw InvalidInputException("Input stream closed");
+        }
+        return line;
+    }
+    
+    // Report a rejected input line
+    void displayInputError(ParseError error, int min, int max) const {
+        out.put("Invalid Input: ").put(describeParseError(error));
+        if (error == ParseError::OutOfRange) {
+            out.put(" (").putInt(min).put('-').putInt(max).put(')');
+        }
     }
     
     // Get valid input from user
-    int getValidInput(int min, int max, const std::string& prompt) {
-        int input;
-        std::string line;
-        
+    int getValidInput(int min, int max, std::string_view prompt) {
         while (true) {
-            try {
-                std::cout << prompt;
-                std::getline(std::cin, line);
-                
-                if (line.empty()) {
-                    throw InvalidInputException("Empty input");
-                }
-                
-                std::stringstream ss(line);
-                ss >> input;
-                
-                if (ss.fail() || !ss.eof()) {
-                    throw InvalidInputException("Non-numeric input");
-                }
-                
-                if (input < min || input > max) {
-                    throw InvalidInputException("Input out of range (" + 
-                                              std::to_string(min) + "-" + std::to_string(max) + ")");
-                }
-                
-                return input;
-                
-            } catch (const InvalidInputException& e) {
-                std::cout << e.what() << ". Please try again.\n";
+            out.put(prompt);
+            out.flush();
+            
+            ParseResult result = parseInt(readInputLine(), min, max);
+            if (result.ok()) {
+                return result.value;
             }
+            
+            displayInputError(result.error, min, max);
+            out.put(". Please try again.\n");
         }
     }
     
     // Get yes/no input from user
-    bool getYesNoInput(const std::string& prompt) {
-        std::string input;
-        
+    bool getYesNoInput(std::string_view prompt) {
         while (true) {
-            try {
-                std::cout << prompt << " (y/n): ";
-                std::getline(std::cin, input);
-                
-                if (input.empty()) {
-                    throw InvalidInputException("Empty input");
+            out.put(prompt).put(" (y/n): ");
+            out.flush();
+            
+            ParseResult result = parseYesNo(readInputLine());
+            if (result.ok()) {
+                return result.value != 0;
+            }
+            
+            displayInputError(result.error, 0, 0);
+            out.put(". Please enter 'y' or 'n'.\n");
+        }
+    }
+    
+    // Open cases selected by player
+    void openCases(const int* casesToOpen, int count) {
+        {
+            instrument::ScopedPhase timer(instrument::Phase::OpenCases);
+            out.put("\nOpening cases...\n");
+            
+            for (int i = 0; i < count; i++) {
+                int caseNum = casesToOpen[i];
+                if (caseNum < 0 || caseNum >= Cases) {
+                    throw GameStateException("Invalid case number: " + std::to_string(caseNum + 1));
                 }
                 
-                char ch = std::tolower(input[0]);
-                if (ch == 'y') return true;
-                if (ch == 'n') return false;
-                
-                throw InvalidInputException("Invalid choice");
+                if (isOpened(caseNum)) {
+                    throw GameStateException("Case " + std::to_string(caseNum + 1) + " already opened");
+                }
                 
-            } catch (const InvalidInputException& e) {
-                std::cout << e.what() << ". Please enter 'y' or 'n'.\n";
+                openedMask = static_cast<Mask>(openedMask | (1u << caseNum));
+                {
+                    instrument::ScopedPhase timer(instrument::Phase::UpdateRemaining);
+                    remaining.open(casePrize[caseNum]);
+                }
+                gameLog.openCase(caseNum);
+                out.put("Case ").putInt(caseNum + 1).put(" contained: ").putMoney(caseValue(caseNum)).newline();
             }
         }
     }
     
-    // Open cases selected by player
-    void openCases(const std::vector<int>& casesToOpen) {
-        std::cout << "\nOpening cases...\n";
+    // Final swap (variants with a swap): trade the player's case for the
+    // last other unopened case. Only the case index changes.
+    void offerSwap(bool human) {
+        int other = -1;
+        for (int i = 0; i < Cases; i++) {
+            if (!isOpened(i) && i != playerCase) other = i;
+        }
+        if (other < 0) return;
         
-        for (int caseNum : casesToOpen) {
-            if (caseNum < 0 || caseNum >= 26) {
-                throw GameStateException("Invalid case number: " + std::to_string(caseNum + 1));
-            }
-            
-            if (casesOpened[caseNum]) {
-                throw GameStateException("Case " + std::to_string(caseNum + 1) + " already opened");
-            }
-            
-            casesOpened[caseNum] = true;
-            std::cout << "Case " << (caseNum + 1) << " contained: $" 
-                      << std::fixed << std::setprecision(2) << caseValues[caseNum] << std::endl;
+        bool swap;
+        char text[64];
+        TextWriter question(text, sizeof(text));
+        question.put("Swap your case ").putInt(playerCase + 1).put(" for case ").putInt(other + 1).put('?');
+        if (human) {
+            if (!out.muted()) aiPlayer.writeSwapAdvice(out, remaining);
+            swap = getYesNoInput(question.view());
+        } else {
+            swap = aiPlayer.shouldSwap(remaining);
+            out.put(question.view()).put(swap ? " Computer says: SWAP!\n" : " Computer says: KEEP!\n");
+        }
+        if (swap) {
+            out.put("Swapped! Your case is now case ").putInt(other + 1).put(".\n");
+            playerCase = other;
+            outcome.swapped = true;
         }
+    }
+    
+    // Capture the result of a finished game
+    void recordOutcome(bool tookDeal) {
+        outcome.completed = true;
+        outcome.tookDeal = tookDeal;
+        outcome.playerCase = playerCase;
+        outcome.finalRound = round;
+        outcome.winnings = finalWinning;
+        outcome.caseValue = caseValue(playerCase);
         
-        updateRemainingPrizes();
+        if (recorder) {
+            trace::Span span("replay append", "io");
+            recorder->append(gameLog);
+        }
     }
     
     // Save game statistics to file
     void saveStats() const {
+        trace::Span span("save stats", "io");
         try {
             std::ofstream file("dealornodeal_stats.txt");
             if (file.is_open()) {
                 file << stats.gamesPlayed << std::endl;
                 file << stats.gamesWon << std::endl;
-                file << stats.totalWinnings << std::endl;
-                file << stats.bestWinning << std::endl;
+                char total[44];
+                file << stats.totalWinnings.format(total) << std::endl;
+                char best[24];
+                TextWriter text(best, sizeof(best));
+                file << text.putCents(stats.bestWinning).view() << std::endl;
                 file.close();
             }
         } catch (const std::exception& e) {
-            std::cout << "Warning: Could not save statistics: " << e.what() << std::endl;
+            out.put("Warning: Could not save statistics: ").put(e.what()).newline();
         }
     }
     
     // Load game statistics from file
     void loadStats() {
+        trace::Span span("load stats", "io");
         try {
             std::ifstream file("dealornodeal_stats.txt");
             if (file.is_open()) {
                 file >> stats.gamesPlayed;
                 file >> stats.gamesWon;
-                file >> stats.totalWinnings;
-                file >> stats.bestWinning;
+                std::string total;
+                double best = 0.0;
+                file >> total >> best;
+                if (!stats.totalWinnings.parse(total)) {
+                    // Written before totals were kept in cents, e.g. "1.23457e+06"
+                    stats.totalWinnings = CentsTotal();
+                    stats.totalWinnings.add(toCents(std::strtod(total.c_str(), nullptr)));
+                }
+                stats.bestWinning = toCents(best);
                 if (stats.gamesPlayed > 0) {
-                    stats.averageWinning = stats.totalWinnings / stats.gamesPlayed;
+                    stats.averageWinning = stats.totalWinnings.dollars() / stats.gamesPlayed;
                 }
                 file.close();
             }
@@ -406,86 +412,134 @@ private:
     }
 
 public:
-    DealOrNoDealGame() : rng(std::chrono::steady_clock::now().time_since_epoch().count()),
-                         playerCase(-1), round(0), finalWinning(0.0) {
+    DealOrNoDealGame(const Rules& gameRules, const BankModel& bankModel, FrameBuffer& output, InputSource& playerInput,
+                     bool persistent = true)
+        : out(output), input(playerInput), rules(gameRules), bank(bankModel), board(gameRules.board), remaining(gameRules.board),
+          openedMask(0),
+          rngState(static_cast<std::uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count())),
+          fixedSeed(0), seedGiven(false),
+          playerCase(-1), round(0), finalWinning(0), persistStats(persistent), recorder(nullptr),
+          lookahead(nullptr), aiPlayer(ComputerPlayer::shared()) {
         try {
-            initializePrizes();
-            aiPlayer = std::make_unique<ComputerPlayer>();
-            loadStats();
+            if (persistStats) loadStats();
         } catch (const std::exception& e) {
             throw GameStateException("Failed to initialize game: " + std::string(e.what()));
         }
     }
     
     ~DealOrNoDealGame() {
-        saveStats();
+        if (persistStats) saveStats();
+    }
+    
+    // Shuffle the next game's prizes with seed `value` and restart the
+    // computer's picks from it (scripted sessions use fixed seeds)
+    void seed(std::uint64_t value) {
+        fixedSeed = value;
+        seedGiven = true;
+        rngState = value;
+    }
+    
+    const GameOutcome& lastOutcome() const {
+        return outcome;
+    }
+    
+    // Append every finished game to a replay log (nullptr to stop recording)
+    void setRecorder(replay::ReplayWriter* writer) {
+        recorder = writer;
+    }
+    
+    // Add the perfect-play verdict to the advice at each offer, computed
+    // in the background by `worker` (nullptr to stop)
+    void setLookahead(LookaheadWorker<Variant>* worker) {
+        lookahead = worker;
     }
     
     // Main game loop for human player
     void playGame() {
+        outcome = GameOutcome();
+        
         try {
-            std::cout << "Welcome to Deal or No Deal!\n";
-            std::cout << "Choose your lucky case (1-26): ";
+            out.put("Welcome to Deal or No Deal!\n");
             
-            playerCase = getValidInput(1, 26, "") - 1;
-            shufflePrizes();
+            char text[64];
+            TextWriter prompt(text, sizeof(text));
+            prompt.put("Choose your lucky case (1-").putInt(Cases).put("): ");
+            playerCase = getValidInput(1, Cases, prompt.view()) - 1;
+            gameLog.begin(shufflePrizes(), replay::PlayMode::Human, playerCase);
             round = 1;
+            outcome.playerCase = playerCase;
             
-            std::cout << "\nYou chose case " << (playerCase + 1) << "!\n";
-            std::cout << "Now let's see what's in the other cases...\n";
-            
-            // Game rounds with different number of cases to open
-            std::vector<int> casesToOpenPerRound = {6, 5, 4, 3, 2, 1, 1, 1, 1};
+            out.put("\nYou chose case ").putInt(playerCase + 1).put("!\n");
+            out.put("Now let's see what's in the other cases...\n");
             
-            for (int roundCases : casesToOpenPerRound) {
-                if (remainingPrizes.size() <= 1) break;
+            for (int r = 0; r < rules.rounds; r++) {
+                int roundCases = rules.casesPerRound[r];
+                if (remaining.count() <= 1) break;
                 
-                displayBoard();
+                if (!out.muted()) {
+                    displayBoard();
+                    if (r == 0) displayOfferPreview(round, roundCases, 0);
+                }
+                gameLog.beginRound();
                 
-                std::cout << "\nSelect " << roundCases << " case(s) to open:\n";
-                std::vector<int> casesToOpen;
+                out.put("\nSelect ").putInt(roundCases).put(" case(s) to open:\n");
+                int casesToOpen[Cases];
+                int selected = 0;
                 
                 for (int i = 0; i < roundCases; i++) {
                     int caseChoice;
                     bool validChoice = false;
+                    prompt = TextWriter(text, sizeof(text));
+                    prompt.put("Case ").putInt(i + 1).put(": ");
+                    speculate(casesToOpen, selected);
                     
                     while (!validChoice) {
-                        caseChoice = getValidInput(1, 26, "Case " + std::to_string(i + 1) + ": ") - 1;
+                        caseChoice = getValidInput(1, Cases, prompt.view()) - 1;
                         
                         if (caseChoice == playerCase) {
-                            std::cout << "You can't open your own case!\n";
-                        } else if (casesOpened[caseChoice]) {
-                            std::cout << "Case already opened!\n";
-                        } else if (std::find(casesToOpen.begin(), casesToOpen.end(), caseChoice) != casesToOpen.end()) {
-                            std::cout << "Case already selected for this round!\n";
+                            out.put("You can't open your own case!\n");
+                        } else if (isOpened(caseChoice)) {
+                            out.put("Case already opened!\n");
+                        } else if (std::count(casesToOpen, casesToOpen + selected, caseChoice) > 0) {
+                            out.put("Case already selected for this round!\n");
                         } else {
-                            casesToOpen.push_back(caseChoice);
+                            casesToOpen[selected++] = caseChoice;
                             validChoice = true;
                         }
                     }
                 }
                 
-                openCases(casesToOpen);
+                openCases(casesToOpen, selected);
                 
-                if (remainingPrizes.size() <= 1) break;
+                if (remaining.count() <= 1) break;
                 
                 // Bank offer
-                double bankOffer = calculateBankOffer();
-                std::cout << "\n" << std::string(50, '=') << std::endl;
-                std::cout << "THE BANK OFFERS: $" << std::fixed << std::setprecision(2) << bankOffer << std::endl;
-                std::cout << std::string(50, '=') << std::endl;
+                Cents bankOffer = calculateBankOffer();
+                displayOffer(bankOffer);
                 
                 // Show AI advice
-                std::cout << aiPlayer->getAdvice(remainingPrizes, bankOffer, remainingPrizes.size());
+                if (!out.muted()) {
+                    instrument::ScopedPhase timer(instrument::Phase::Decision);
+                    aiPlayer.writeAdvice(out, remaining, toDollars(bankOffer), remaining.count(),
+                                         rules.finalSwap);
+                    if (lookahead) {
+                        speculate(nullptr, 0);
+                        const LookaheadTable<Variant>* table = lookahead->wait(remaining.inPlay());
+                        if (table) table->writeAdvice(out, remaining.inPlay(), toDollars(bankOffer));
+                    }
+                    if (round < rules.rounds) displayOfferPreview(round + 1, rules.casesPerRound[round], bankOffer);
+                }
                 
-                if (getYesNoInput("Deal or No Deal?")) {
+                bool accepted = getYesNoInput("Deal or No Deal?");
+                gameLog.offer(bankOffer, accepted);
+                
+                if (accepted) {
                     finalWinning = bankOffer;
-                    std::cout << "\nCongratulations! You won $" << std::fixed << std::setprecision(2) 
-                              << finalWinning << "!\n";
-                    std::cout << "Your case contained: $" << std::fixed << std::setprecision(2) 
-                              << caseValues[playerCase] << std::endl;
+                    out.put("\nCongratulations! You won ").putMoney(finalWinning).put("!\n");
+                    out.put("Your case contained: ").putMoney(caseValue(playerCase)).newline();
                     
                     stats.updateStats(finalWinning);
+                    recordOutcome(true);
                     return;
                 }
                 
@@ -493,86 +547,102 @@ public:
             }
             
             // Final case reveal
-            finalWinning = caseValues[playerCase];
-            std::cout << "\nNo more deals! You're going home with your case!\n";
-            std::cout << "Your case contained: $" << std::fixed << std::setprecision(2) 
-                      << finalWinning << "!\n";
+            if (rules.finalSwap) offerSwap(true);
+            finalWinning = caseValue(playerCase);
+            out.put("\nNo more deals! You're going home with your case!\n");
+            out.put("Your case contained: ").putMoney(finalWinning).put("!\n");
             
             stats.updateStats(finalWinning);
+            recordOutcome(false);
             
         } catch (const GameException& e) {
-            std::cout << "Game Error: " << e.what() << std::endl;
+            out.put("Game Error: ").put(e.what()).newline();
         } catch (const std::exception& e) {
-            std::cout << "Unexpected Error: " << e.what() << std::endl;
+            out.put("Unexpected Error: ").put(e.what()).newline();
         }
     }
     
     // Computer player auto-play
     void computerPlay() {
+        outcome = GameOutcome();
+        
         try {
-            std::cout << "Computer Player is playing...\n";
+            out.put("Computer Player is playing...\n");
             
             // Computer selects a random case
-            std::uniform_int_distribution<int> dist(0, 25);
-            playerCase = dist(rng);
-            shufflePrizes();
+            playerCase = static_cast<int>(replay::splitMix64(rngState) % Cases);
+            gameLog.begin(shufflePrizes(), replay::PlayMode::Computer, playerCase);
             round = 1;
+            outcome.playerCase = playerCase;
             
-            std::cout << "Computer chose case " << (playerCase + 1) << std::endl;
-            
-            std::vector<int> casesToOpenPerRound = {6, 5, 4, 3, 2, 1, 1, 1, 1};
+            out.put("Computer chose case ").putInt(playerCase + 1).newline();
             
-            for (int roundCases : casesToOpenPerRound) {
-                if (remainingPrizes.size() <= 1) break;
+            for (int r = 0; r < rules.rounds; r++) {
+                int roundCases = rules.casesPerRound[r];
+                if (remaining.count() <= 1) break;
                 
-                std::cout << "\n=== ROUND " << round << " ===\n";
+                out.put("\n=== ROUND ").putInt(round).put(" ===\n");
+                gameLog.beginRound();
                 
                 // Computer selects cases to open
-                std::vector<int> casesToOpen = aiPlayer->selectCasesToOpen(casesOpened, roundCases);
+                int casesToOpen[Cases];
+                int selected;
+                {
+                    instrument::ScopedPhase timer(instrument::Phase::Decision);
+                    selected = aiPlayer.selectCasesToOpen<Cases>(openedMask, roundCases, replay::splitMix64(rngState),
+                                                             casesToOpen);
+                }
                 
                 // Remove player's case from selection
-                casesToOpen.erase(std::remove(casesToOpen.begin(), casesToOpen.end(), playerCase), casesToOpen.end());
+                selected = static_cast<int>(std::remove(casesToOpen, casesToOpen + selected, playerCase) - casesToOpen);
                 
-                openCases(casesToOpen);
+                openCases(casesToOpen, selected);
                 
-                if (remainingPrizes.size() <= 1) break;
+                if (remaining.count() <= 1) break;
                 
-                double bankOffer = calculateBankOffer();
-                std::cout << "\nBank Offer: $" << std::fixed << std::setprecision(2) << bankOffer << std::endl;
+                Cents bankOffer = calculateBankOffer();
+                out.put("\nBank Offer: ").putMoney(bankOffer).newline();
                 
                 // Computer makes decision
-                if (aiPlayer->shouldAcceptDeal(remainingPrizes, bankOffer, remainingPrizes.size())) {
+                bool accepted;
+                {
+                    instrument::ScopedPhase timer(instrument::Phase::Decision);
+                    accepted = aiPlayer.shouldAcceptDeal(remaining, toDollars(bankOffer), remaining.count());
+                }
+                gameLog.offer(bankOffer, accepted);
+                
+                if (accepted) {
                     finalWinning = bankOffer;
-                    std::cout << "Computer says: DEAL!\n";
-                    std::cout << "Computer won: $" << std::fixed << std::setprecision(2) 
-                              << finalWinning << std::endl;
-                    std::cout << "Computer's case contained: $" << std::fixed << std::setprecision(2) 
-                              << caseValues[playerCase] << std::endl;
+                    out.put("Computer says: DEAL!\n");
+                    out.put("Computer won: ").putMoney(finalWinning).newline();
+                    out.put("Computer's case contained: ").putMoney(caseValue(playerCase)).newline();
                     
                     stats.updateStats(finalWinning);
+                    recordOutcome(true);
                     return;
                 }
                 
-                std::cout << "Computer says: NO DEAL!\n";
+                out.put("Computer says: NO DEAL!\n");
                 round++;
             }
             
-            finalWinning = caseValues[playerCase];
-            std::cout << "\nComputer's final case contained: $" << std::fixed << std::setprecision(2) 
-                      << finalWinning << "!\n";
+            if (rules.finalSwap) offerSwap(false);
+            finalWinning = caseValue(playerCase);
+            out.put("\nComputer's final case contained: ").putMoney(finalWinning).put("!\n");
             
             stats.updateStats(finalWinning);
+            recordOutcome(false);
             
         } catch (const GameException& e) {
-            std::cout << "Computer Game Error: " << e.what() << std::endl;
+            out.put("Computer Game Error: ").put(e.what()).newline();
         } catch (const std::exception& e) {
-            std::cout << "Unexpected Error: " << e.what() << std::endl;
+            out.put("Unexpected Error: ").put(e.what()).newline();
         }
     }
     
     // Display game statistics
     void displayStatistics() const {
-        stats.displayStats();
+        stats.displayStats(out);
     }
     
     // Reset statistics
@@ -580,87 +650,106 @@ public:
         stats = GameStats();
         try {
             std::remove("dealornodeal_stats.txt");
-            std::cout << "Statistics reset successfully!\n";
+            out.put("Statistics reset successfully!\n");
         } catch (const std::exception& e) {
-            std::cout << "Warning: Could not delete statistics file: " << e.what() << std::endl;
+            out.put("Warning: Could not delete statistics file: ").put(e.what()).newline();
         }
     }
 };
 
 // Main menu system
+template <class Variant>
 class GameMenu {
 private:
-    std::unique_ptr<DealOrNoDealGame> game;
+    const BasicGameRules<Variant::Cases>& rules;
+    const BasicBankModel<Variant::Cases>& bank;
+    FrameBuffer screen;
+    StreamInput keyboard;
+    replay::ReplayWriter* recorder;
+    LookaheadWorker<Variant> lookahead;
+    std::unique_ptr<DealOrNoDealGame<Variant>> game;
+    
+    void newGame() {
+        game = std::make_unique<DealOrNoDealGame<Variant>>(rules, bank, screen, keyboard);
+        game->setRecorder(recorder);
+        game->setLookahead(&lookahead);
+    }
     
 public:
-    GameMenu() {
+    GameMenu(const BasicGameRules<Variant::Cases>& gameRules, const BasicBankModel<Variant::Cases>& bankModel,
+             replay::ReplayWriter* replayLog = nullptr)
+        : rules(gameRules), bank(bankModel), keyboard(std::cin), recorder(replayLog), lookahead(gameRules, bankModel) {
         try {
-            game = std::make_unique<DealOrNoDealGame>();
+            newGame();
         } catch (const std::exception& e) {
-            std::cout << "Failed to initialize game: " << e.what() << std::endl;
+            screen.put("Failed to initialize game: ").put(e.what()).newline();
+            screen.flush();
             throw;
         }
     }
     
     void displayMenu() {
-        std::cout << "\n" << std::string(50, '=') << std::endl;
-        std::cout << "        DEAL OR NO DEAL - MAIN MENU" << std::endl;
-        std::cout << std::string(50, '=') << std::endl;
-        std::cout << "1. Play Game (Human Player)" << std::endl;
-        std::cout << "2. Computer Auto-Play" << std::endl;
-        std::cout << "3. View Statistics" << std::endl;
-        std::cout << "4. Reset Statistics" << std::endl;
-        std::cout << "5. Game Rules" << std::endl;
-        std::cout << "6. Exit" << std::endl;
-        std::cout << std::string(50, '=') << std::endl;
+        screen.newline().repeat('=', 50).newline();
+        screen.put("        DEAL OR NO DEAL - MAIN MENU\n");
+        screen.repeat('=', 50).newline();
+        screen.put("1. Play Game (Human Player)\n");
+        screen.put("2. Computer Auto-Play\n");
+        screen.put("3. View Statistics\n");
+        screen.put("4. Reset Statistics\n");
+        screen.put("5. Game Rules\n");
+        screen.put("6. Exit\n");
+        screen.repeat('=', 50).newline();
     }
     
     void displayRules() {
-        std::cout << "\n" << std::string(50, '=') << std::endl;
-        std::cout << "                 GAME RULES" << std::endl;
-        std::cout << std::string(50, '=') << std::endl;
-        std::cout << "1. Choose your lucky case (1-26)" << std::endl;
-        std::cout << "2. Open other cases to reveal their prizes" << std::endl;
-        std::cout << "3. The bank will make offers based on remaining prizes" << std::endl;
-        std::cout << "4. Decide: DEAL (accept offer) or NO DEAL (continue)" << std::endl;
-        std::cout << "5. If you reject all offers, you win your case's prize" << std::endl;
-        std::cout << "6. AI Advisor provides recommendations" << std::endl;
-        std::cout << "7. Computer player uses advanced strategy" << std::endl;
-        std::cout << "\nPrizes range from $0.01 to $1,000,000" << std::endl;
-        std::cout << std::string(50, '=') << std::endl;
+        screen.newline().repeat('=', 50).newline();
+        screen.put("                 GAME RULES\n");
+        screen.repeat('=', 50).newline();
+        screen.put("1. Choose your lucky case (1-").putInt(Variant::Cases).put(")\n");
+        screen.put("2. Open other cases to reveal their prizes\n");
+        screen.put("3. The bank will make offers based on remaining prizes\n");
+        screen.put("4. Decide: DEAL (accept offer) or NO DEAL (continue)\n");
+        screen.put("5. If you reject all offers, you win your case's prize\n");
+        screen.put("6. AI Advisor provides recommendations\n");
+        screen.put("7. Computer player uses advanced strategy\n");
+        const BasicPrizeBoard<Variant::Cases>& board = rules.board;
+        screen.put("\nPrizes range from ").putMoney(board.value[0])
+              .put(" to ").putMoney(board.value[Variant::Cases - 1], 0).newline();
+        screen.repeat('=', 50).newline();
     }
     
     void run() {
-        int choice;
+        std::string_view input;
         
         while (true) {
             try {
                 displayMenu();
                 
-                std::cout << "Enter your choice (1-6): ";
-                std::string input;
-                std::getline(std::cin, input);
+                screen.put("Enter your choice (1-6): ");
+                screen.flush();
+                if (!keyboard.readLine(input)) {
+                    // Input closed: leave the menu as if Exit was chosen
+                    screen.newline();
+                    return;
+                }
                 
-                if (input.empty()) {
-                    std::cout << "Invalid choice. Please try again.\n";
+                ParseResult choice = parseInt(input, 1, 6);
+                if (choice.error == ParseError::Empty) {
+                    screen.put("Invalid choice. Please try again.\n");
                     continue;
                 }
-                
-                std::stringstream ss(input);
-                ss >> choice;
-                
-                if (ss.fail() || !ss.eof()) {
-                    std::cout << "Invalid choice. Please enter a number.\n";
+                if (choice.error == ParseError::NonNumeric) {
+                    screen.put("Invalid choice. Please enter a number.\n");
                     continue;
                 }
                 
-                switch (choice) {
+                switch (choice.value) {
                     case 1:
-                        game = std::make_unique<DealOrNoDealGame>();
+                        newGame();
                         game->playGame();
                         break;
                     case 2:
-                        game = std::make_unique<DealOrNoDealGame>();
+                        newGame();
                         game->computerPlay();
                         break;
                     case 3:
@@ -673,29 +762,791 @@ public:
                         displayRules();
                         break;
                     case 6:
-                        std::cout << "Thank you for playing Deal or No Deal!\n";
+                        screen.put("Thank you for playing Deal or No Deal!\n");
                         return;
                     default:
-                        std::cout << "Invalid choice. Please select 1-6.\n";
+                        screen.put("Invalid choice. Please select 1-6.\n");
                 }
                 
             } catch (const std::exception& e) {
-                std::cout << "Error: " << e.what() << std::endl;
-                std::cout << "Please try again.\n";
+                screen.put("Error: ").put(e.what()).newline();
+                screen.put("Please try again.\n");
+            }
+        }
+    }
+};
+
+// Scripted batch mode: plays every session of a script through the human
+// code path with the console front-end muted and reports each outcome
+class BatchRunner {
+private:
+    FrameBuffer report;
+    FrameBuffer console;
+    
+    void reportSession(std::size_t number, const GameOutcome& result, std::size_t unused) {
+        report.put("session=").putInt(static_cast<long long>(number));
+        if (!result.completed) {
+            report.put(" status=incomplete case=").putInt(result.playerCase + 1).newline();
+            return;
+        }
+        report.put(" status=ok case=").putInt(result.playerCase + 1);
+        report.put(" round=").putInt(result.finalRound);
+        report.put(result.tookDeal ? " deal=yes" : " deal=no");
+        if (result.swapped) report.put(" swap=yes");
+        report.put(" winnings=").putCents(result.winnings);
+        report.put(" case_value=").putCents(result.caseValue);
+        if (unused > 0) report.put(" unused=").putInt(static_cast<long long>(unused));
+        report.newline();
+    }
+    
+public:
+    BatchRunner() : report(1), console(FrameBuffer::Muted) {}
+    
+    // Script text from `path` ('-' for stdin)
+    static std::string loadScript(const std::string& path) {
+        trace::Span span("load script", "io");
+        if (path == "-") {
+            std::ostringstream text;
+            text << std::cin.rdbuf();
+            return text.str();
+        }
+        
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw GameException("Cannot open script file: " + path);
+        }
+        std::ostringstream text;
+        text << file.rdbuf();
+        return text.str();
+    }
+    
+    // Play the script `repeat` times; session i is shuffled with seed + i
+    template <class Variant>
+    int run(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank,
+            const std::string& path, int repeat, std::uint64_t seed, replay::ReplayWriter* recorder) {
+        ScriptInput script(loadScript(path));
+        if (script.sessionCount() == 0) {
+            throw GameException("Script contains no sessions: " + path);
+        }
+        
+        DealOrNoDealGame<Variant> game(rules, bank, console, script, false);
+        game.setRecorder(recorder);
+        GameStats totals;
+        std::size_t incomplete = 0;
+        std::size_t number = 0;
+        auto started = std::chrono::steady_clock::now();
+        
+        for (int pass = 0; pass < repeat; pass++) {
+            for (std::size_t i = 0; i < script.sessionCount(); i++) {
+                script.beginSession(i);
+                game.seed(seed + number);
+                game.playGame();
+                console.discard();
+                
+                const GameOutcome& result = game.lastOutcome();
+                number++;
+                if (result.completed) {
+                    totals.updateStats(result.winnings);
+                } else {
+                    incomplete++;
+                }
+                reportSession(number, result, script.unusedAnswers());
+            }
+        }
+        
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        report.put("\n=== BATCH SUMMARY ===\n");
+        report.put("Sessions: ").putInt(static_cast<long long>(number));
+        report.put(" (incomplete: ").putInt(static_cast<long long>(incomplete)).put(")\n");
+        report.put("Elapsed: ").putFixed(seconds, 3).put(" s (");
+        report.putFixed(seconds > 0 ? number / seconds : 0.0, 0).put(" sessions/s)\n");
+        totals.displayStats(report);
+        report.flush();
+        
+        return incomplete == 0 ? 0 : 2;
+    }
+};
+
+// Allocation check: plays computer games, and the sessions of a script if
+// one is given, through the full game loop with every frame rendered and
+// dropped. The first game of each kind warms up the game's buffers; the
+// check fails if any later game makes a heap allocation. Sessions that end
+// in an input error are not checked: errors are reported by exception.
+class AllocationCheck {
+private:
+    static constexpr std::uint64_t MaxReported = 10;
+    
+    FrameBuffer report;
+    FrameBuffer console;
+    std::uint64_t checked;
+    std::uint64_t failed;
+    
+    template <class Game, class Play>
+    void measure(const char* kind, long long number, bool warmUp, const Game& game, const Play& play) {
+        std::uint64_t before = alloc::threadAllocations();
+        play();
+        console.discard();
+        std::uint64_t made = alloc::threadAllocations() - before;
+        if (warmUp || !game.lastOutcome().completed) return;
+        checked++;
+        if (made > 0 && ++failed <= MaxReported) {
+            report.put(kind).put(' ').putInt(number).put(": ").putUnsigned(made).put(" allocations\n");
+        }
+    }
+    
+public:
+    AllocationCheck() : report(1), console(FrameBuffer::Discard), checked(0), failed(0) {}
+    
+    // Play `games` computer games, and each session of the script at
+    // `scriptPath` (if not empty) `repeat` times, after one warm-up each
+    template <class Variant>
+    int run(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank,
+            long long games, const std::string& scriptPath, int repeat, std::uint64_t seed) {
+        ScriptInput script(scriptPath.empty() ? std::string() : BatchRunner::loadScript(scriptPath));
+        DealOrNoDealGame<Variant> game(rules, bank, console, script, false);
+        report.put("=== ALLOCATION CHECK ===\n");
+        
+        for (long long i = 0; i <= games; i++) {
+            game.seed(seed + static_cast<std::uint64_t>(i));
+            measure("computer game", i, i == 0, game, [&]() { game.computerPlay(); });
+        }
+        report.put("Computer games: ").putInt(games).put(" after 1 warm-up\n");
+        
+        if (script.sessionCount() > 0) {
+            long long number = 0;
+            for (int pass = 0; pass <= repeat; pass++) {
+                for (std::size_t i = 0; i < script.sessionCount(); i++) {
+                    script.beginSession(i);
+                    game.seed(seed + static_cast<std::uint64_t>(number));
+                    measure("script session", ++number, pass == 0, game, [&]() { game.playGame(); });
+                }
+            }
+            report.put("Script sessions: ").putInt(static_cast<long long>(script.sessionCount()) * repeat);
+            report.put(" after ").putInt(static_cast<long long>(script.sessionCount())).put(" warm-up");
+            report.put(" (incomplete sessions are not checked)\n");
+        }
+        
+        report.put(failed == 0 ? "PASS: " : "FAIL: ").putUnsigned(failed).put(" of ").putUnsigned(checked);
+        report.put(" finished games allocated\n");
+        report.flush();
+        return failed == 0 ? 0 : 3;
+    }
+};
+
+// Bank solver mode: searches for the per-round offer multipliers that
+// minimise the bank's expected payout while keeping enough games going
+class SolverRunner {
+private:
+    FrameBuffer report;
+    
+    void reportSchedule(const char* label, const SolverResult& result, int rounds) {
+        report.put(label).put(" payout=").putFixed(result.evaluation.payout, 2);
+        report.put(" reach=").putFixed(100.0 * result.evaluation.reach, 2).put('%');
+        report.put(result.feasible ? "" : " (infeasible)").put(" offer =");
+        for (int r = 0; r < rounds; r++) report.put(' ').putFixed(result.multipliers[r], 4);
+        report.newline();
+    }
+    
+public:
+    SolverRunner() : report(1) {}
+    
+    template <class Variant>
+    int run(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank,
+            const BasicPlayerPolicy<Variant::Cases>& player, int round, double target, int threads) {
+        if (!bank.scalesWithMultiplier()) {
+            throw GameException(std::string("The ") + bank.name() + " bank model has no multipliers to optimise");
+        }
+        if (round > rules.rounds) {
+            throw GameException("The variant has only " + std::to_string(rules.rounds) + " rounds");
+        }
+        
+        report.put("=== BANK SOLVER ===\n");
+        report.put("Variant: ").put(rules.name).put("  Bank: ").put(bank.name());
+        report.put("  Player: ").put(player.name()).put("  Threads: ").putInt(threads).newline();
+        report.put("Constraint: P(reach round ").putInt(round).put(") >= ").putFixed(100.0 * target, 1).put("%\n");
+        report.flush();
+        
+        auto started = std::chrono::steady_clock::now();
+        BankSolver<Variant> solver(rules, bank, player, round, threads);
+        SolverResult best = solver.optimize(rules.offerMultiplier, target, [&](const SolverResult& step) {
+            reportSchedule(step.evaluations == 1 ? "start:" : "step: ", step, rules.rounds);
+            report.flush();
+        });
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        
+        reportSchedule("best: ", best, rules.rounds);
+        report.put("Evaluations: ").putInt(best.evaluations).put(" in ").putFixed(seconds, 1).put(" s\n");
+        report.put("\n# Variant file line for this schedule\noffer =");
+        for (int r = 0; r < rules.rounds; r++) report.put(' ').putFixed(best.multipliers[r], 4);
+        report.newline();
+        report.flush();
+        return best.feasible ? 0 : 2;
+    }
+};
+
+// Analysis mode: exact outcomes of one mid-game position, optimal play
+// and the chosen player's
+class AnalysisRunner {
+private:
+    FrameBuffer report;
+    
+public:
+    AnalysisRunner() : report(1) {}
+    
+    // `prizes` lists the dollar amounts still in play, comma-separated
+    template <class Variant>
+    int run(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank,
+            const BasicPlayerPolicy<Variant::Cases>* player, int round, std::string_view prizes, int threads) {
+        using Analyzer = PositionAnalyzer<Variant>;
+        std::vector<double> amounts;
+        if (!rules_detail::parseList(prizes, amounts)) {
+            throw GameException("Cannot parse prize list: " + std::string(prizes));
+        }
+        CaseMask<Variant::Cases> position = 0;
+        for (double amount : amounts) {
+            int found = -1;
+            for (int i = 0; i < Variant::Cases && found < 0; i++) {
+                if (std::fabs(rules.board.value[i] - amount) < 0.005 && !((position >> i) & 1u)) found = i;
+            }
+            if (found < 0) {
+                std::ostringstream text;
+                text << "Prize not on the board, or listed twice: $" << amount;
+                throw GameException(text.str());
+            }
+            position = static_cast<CaseMask<Variant::Cases>>(position | (1u << found));
+        }
+        
+        auto started = std::chrono::steady_clock::now();
+        Analyzer analyzer(rules, bank, player, threads);
+        double setupSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        
+        started = std::chrono::steady_clock::now();
+        typename Analyzer::Analysis result;
+        std::string error;
+        if (!analyzer.analyze(position, round, result, error)) {
+            throw GameException("Cannot analyse position: " + error);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+        
+        report.put("=== POSITION ANALYSIS ===\n");
+        report.put("Variant: ").put(rules.name).put("  Bank: ").put(bank.name());
+        report.put("  Player: ").put(result.player).put("  Threads: ").putInt(threads).newline();
+        report.put("Setup: ").putFixed(setupSeconds, 3).put(" s  Analysis: ");
+        report.putFixed(1000.0 * seconds, 3).put(" ms\n");
+        report.put("Prizes in play: ").putInt(result.prizesInPlay).put(" (mean ").putMoney(result.prizeMean).put(")\n");
+        report.put("Next offer: round ").putInt(result.round);
+        if (result.offerOnTable) report.put(", on the table: ").putMoney(result.offer);
+        report.newline();
+        report.put("Optimal play: ").putMoney(result.optimalValue).put("\n\n");
+        
+        for (int r = result.round; r <= rules.rounds; r++) {
+            report.put("round=").putInt(r).put(" expected_offer=").putFixed(result.expectedOffer[r - 1], 2);
+            report.put(" optimal_from=").putFixed(result.optimalFrom[r - 1], 2).newline();
+        }
+        report.put("no_deal=").putFixed(result.prizeMean, 2).put("\n\n");
+        
+        report.put("Player ").put(result.player).put(": mean ").putMoney(result.playerValue);
+        report.put(" (sd ").putMoney(result.playerDeviation).put(")\n");
+        for (int r = result.round; r <= rules.rounds; r++) {
+            report.put("round=").putInt(r).put(" deal=").putFixed(100.0 * result.dealProbability[r - 1], 3);
+            report.put("% mean_offer=").putFixed(result.dealMean[r - 1], 2).newline();
+        }
+        for (int i = 0; i < Variant::Cases; i++) {
+            if (!((position >> i) & 1u)) continue;
+            report.put("prize=").putFixed(rules.board.value[i], 2);
+            report.put(" no_deal=").putFixed(100.0 * result.prizeProbability[i], 3).put("%\n");
+        }
+        report.flush();
+        return 0;
+    }
+};
+
+// Replay viewer: reconstructs recorded games from a replay log
+class ReplayViewer {
+private:
+    FrameBuffer out;
+    replay::ReplayReader reader;
+    
+    void displaySummary(std::size_t index, const replay::GameLog& log) {
+        replay::ReplayPosition end = replay::seekRound(log, StandardBoard.cents, PrizeBoard::Size, log.roundCount);
+        out.put("game=").putInt(static_cast<long long>(index + 1));
+        out.put(log.mode == replay::PlayMode::Human ? " mode=human" : " mode=computer");
+        out.put(" case=").putInt(log.playerCase + 1);
+        out.put(" rounds=").putInt(log.roundCount);
+        out.put(end.dealt ? " deal=yes" : " deal=no");
+        out.put(" winnings=").putCents(end.winnings).newline();
+    }
+    
+    void displayPosition(const replay::GameLog& log, const replay::ReplayPosition& pos) {
+        out.put("\n=== REPLAY - AFTER ROUND ").putInt(pos.round).put(" ===\n");
+        out.put("Seed: ").putUnsigned(log.seed).newline();
+        out.put("Player Case: ").putInt(log.playerCase + 1)
+           .put(" (contains ").putMoney(pos.caseValues[log.playerCase]).put(")\n");
+        
+        int index = 0;
+        for (int r = 0; r < pos.round; r++) {
+            out.put("Round ").putInt(r + 1).put(" opened:");
+            for (int i = 0; i < log.openedPerRound[r]; i++) {
+                int caseIndex = log.opened[index++];
+                out.put(' ').putInt(caseIndex + 1).put('=').putMoney(pos.caseValues[caseIndex]);
+            }
+            out.newline();
+        }
+        
+        out.put("Remaining Cases: ").putInt(pos.remainingCount);
+        out.put(" (average ").putMoney(pos.remainingCount > 0 ? toDollars(pos.remainingSum) / pos.remainingCount : 0.0)
+           .put(")\n");
+        if (pos.hasOffer) {
+            out.put("Bank Offer: ").putMoney(pos.offer).newline();
+        }
+        if (pos.finished) {
+            out.put(pos.dealt ? "Result: DEAL for " : "Result: NO DEAL, case paid ")
+               .putMoney(pos.winnings).newline();
+        }
+    }
+    
+public:
+    // Convert a replay log into a 32-byte-per-game compact archive
+    int exportArchive(const std::string& path, const std::string& archivePath) {
+        if (!reader.open(path)) {
+            throw GameException("Cannot read replay log: " + path);
+        }
+        
+        std::vector<compact::GameRecord> records;
+        records.reserve(reader.size());
+        std::size_t skipped = 0;
+        replay::GameLog log;
+        compact::GameLayout layout;
+        compact::GameRecord record;
+        
+        for (std::size_t i = 0; i < reader.size(); i++) {
+            if (reader.load(i, log) && compact::fromGameLog(log, layout) && compact::encode(layout, record)) {
+                records.push_back(record);
+            } else {
+                skipped++;
             }
         }
+        
+        if (!compact::writeArchive(archivePath, records)) {
+            throw GameException("Cannot write archive: " + archivePath);
+        }
+        
+        out.put("Archived ").putInt(static_cast<long long>(records.size())).put(" games (")
+           .putInt(static_cast<long long>(records.size() * sizeof(compact::GameRecord))).put(" bytes)");
+        if (skipped > 0) out.put(", skipped ").putInt(static_cast<long long>(skipped));
+        out.newline();
+        return skipped == 0 ? 0 : 2;
+    }
+    
+    // List every game, or show one game (1-based) after `round` rounds
+    int run(const std::string& path, long long game, int round) {
+        if (!reader.open(path)) {
+            throw GameException("Cannot read replay log: " + path);
+        }
+        
+        replay::GameLog log;
+        if (game <= 0) {
+            for (std::size_t i = 0; i < reader.size(); i++) {
+                if (reader.load(i, log)) displaySummary(i, log);
+            }
+            out.put("Games: ").putInt(static_cast<long long>(reader.size())).newline();
+            return 0;
+        }
+        
+        if (!reader.load(static_cast<std::size_t>(game - 1), log)) {
+            throw GameException("No such game in replay log: " + std::to_string(game));
+        }
+        displaySummary(static_cast<std::size_t>(game - 1), log);
+        int target = round < 0 ? log.roundCount : round;
+        displayPosition(log, replay::seekRound(log, StandardBoard.cents, PrizeBoard::Size, target));
+        return 0;
     }
 };
 
+// Hosted mode: serve games over a socket until interrupted
+template <class Variant>
+static int runServer(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank,
+                     const std::string& endpoint, int threads, int maxSessions, int cacheMegabytes) {
+#if defined(__linux__)
+    ServerOptions options;
+    options.endpoint = endpoint;
+    options.threads = threads;
+    options.maxSessions = static_cast<std::size_t>(maxSessions);
+    options.previewCacheBytes = static_cast<std::size_t>(cacheMegabytes) << 20;
+    
+    GameServer server(options);
+    if (!server.open()) {
+        throw GameException("Cannot listen on " + endpoint + ": " + std::strerror(errno));
+    }
+    
+    std::cout << "Serving on " << endpoint << " with " << threads << " thread(s). Press Ctrl+C to stop."
+              << std::endl;
+    ServerCounters totals = server.run<Variant>(rules, bank);
+    std::cout << "Server stopped: " << totals.accepted << " connections, " << totals.rejected
+              << " rejected, " << totals.commands << " commands, peak " << totals.peakSessions
+              << " sessions" << std::endl;
+    return 0;
+#else
+    (void)rules;
+    (void)bank;
+    (void)endpoint;
+    (void)threads;
+    (void)maxSessions;
+    (void)cacheMegabytes;
+    throw GameException("Server mode requires Linux (epoll)");
+#endif
+}
+
+// Phase profile of an instrumented build, written to stderr at exit
+static bool profileAsJson = false;
+
+static void dumpProfile() {
+    FrameBuffer err(2);
+    instrument::dump(err, profileAsJson);
+}
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--script FILE [--repeat N] [--seed S]] [--record LOG]\n"
+              << "       " << program << " --replay LOG [--game N] [--round R] [--archive OUT]\n"
+              << "  --script FILE  play scripted sessions from FILE ('-' for stdin)\n"
+              << "  --repeat N     play the whole script N times (default 1)\n"
+              << "  --seed S       base seed for the prize shuffle (default 1)\n"
+              << "  --record LOG   append every finished game to replay log LOG\n"
+              << "  --replay LOG   list the games in LOG, or show game N after round R\n"
+              << "  --archive OUT  with --replay or --simulate, write the games as 32-byte compact\n"
+              << "                 records to OUT\n"
+              << "       " << program << " --serve ENDPOINT [--threads N] [--max-sessions N] [--cache-mb N]\n"
+              << "  --serve EP     host games over a line protocol on unix:/path or tcp:[host:]port\n"
+              << "  --threads N    number of reactor threads for --serve (default 1)\n"
+              << "  --max-sessions N  concurrent session limit for --serve (default 100000)\n"
+              << "  --cache-mb N   memory for offer previews shared by all sessions (default 16, 0 for none)\n"
+              << "  --variant NAME show format for play, --script and --serve:";
+    forEachVariant([](auto variant) { std::cout << ' ' << decltype(variant)::Name; });
+    std::cout << " (default " << StandardVariant::Name << ")\n"
+              << "  --variant-file F  load prizes, round schedule and offer curve from variant file F\n"
+              << "  --bank MODEL   how the bank prices offers:";
+    for (std::string_view name : BankModelNames) std::cout << ' ' << name;
+    std::cout << " (default mean)\n"
+              << "       " << program << " --simulate N [--seed S] [--bank MODEL] [--variant NAME] [--threads N]\n"
+              << "       [--archive OUT]\n"
+              << "  --simulate N   play N computer games against the bank and report its payout;\n"
+              << "                 --threads defaults to all cores\n"
+              << "  --swap-policy P  final swap in simulations of swap variants: keep, swap or computer\n"
+              << "       " << program << " --check-allocations N [--script FILE [--repeat N]] [--seed S]\n"
+              << "  --check-allocations N  play N computer games (and the script's sessions) after a\n"
+              << "                 warm-up and fail if any of them allocates heap memory\n"
+              << "       " << program << " --optimize-bank K:P [--player NAME] [--bank MODEL] [--threads N]\n"
+              << "  --optimize-bank K:P  find offer multipliers minimising the bank's payout while\n"
+              << "                 P(game reaches round K) >= P; --threads defaults to all cores\n"
+              << "  --player NAME  contestant the bank plans for:";
+    for (std::string_view name : PlayerPolicyNames) std::cout << ' ' << name;
+    std::cout << " (default computer; --analyze also takes optimal)\n"
+              << "  --profile FMT  with a -DDEALMASTER_INSTRUMENT=1 build, print per-phase timings of\n"
+              << "                 the game loop to stderr at exit as a table or json\n"
+              << "  --trace FILE   write a timeline of simulation batches, solver phases, server\n"
+              << "                 event batches and file I/O to FILE in Chrome trace format\n"
+              << "  --metrics FILE rewrite FILE every 5 s with Prometheus metrics of --simulate or\n"
+              << "                 --serve (games/s, deals per round, latencies, sessions, memory)\n"
+              << "       " << program << " --analyze R:PRIZES [--player NAME] [--bank MODEL] [--threads N]\n"
+              << "  --analyze R:PRIZES  exact outcomes of the position with PRIZES (comma-separated\n"
+              << "                 dollar amounts, the player's case among them) in play before\n"
+              << "                 the offer of round R; --threads defaults to all cores\n";
+}
+
 // Main function
-int main() {
+int main(int argc, char* argv[]) {
+    std::string scriptPath;
+    std::string recordPath;
+    std::string replayPath;
+    std::string archivePath;
+    int repeat = 1;
+    std::uint64_t seed = 1;
+    long long replayGame = 0;
+    int replayRound = -1;
+    std::string serveEndpoint;
+    int serveThreads = 1;
+    int maxSessions = 100000;
+    int cacheMegabytes = 16;
+    std::string variantName(StandardVariant::Name);
+    std::string variantFile;
+    std::string bankName("mean");
+    long long simulateGames = 0;
+    long long checkGames = 0;
+    int solveRound = 0;
+    double solveTarget = 0.0;
+    std::string playerName("computer");
+    int analyzeRound = 0;
+    std::string analyzePrizes;
+    SwapPolicy swapPolicy = SwapPolicy::Computer;
+    bool threadsGiven = false;
+    bool checkAllocations = false;
+    std::string tracePath;
+    std::string metricsPath;
+    
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--script" && hasValue) {
+            scriptPath = argv[++i];
+        } else if (arg == "--repeat" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            repeat = value.value;
+        } else if (arg == "--seed" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 0, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            seed = static_cast<std::uint64_t>(value.value);
+        } else if (arg == "--record" && hasValue) {
+            recordPath = argv[++i];
+        } else if (arg == "--replay" && hasValue) {
+            replayPath = argv[++i];
+        } else if (arg == "--serve" && hasValue) {
+            serveEndpoint = argv[++i];
+        } else if (arg == "--threads" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, 1024);
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            serveThreads = value.value;
+            threadsGiven = true;
+        } else if (arg == "--max-sessions" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            maxSessions = value.value;
+        } else if (arg == "--cache-mb" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 0, 65536);
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            cacheMegabytes = value.value;
+        } else if (arg == "--variant" && hasValue) {
+            variantName = argv[++i];
+        } else if (arg == "--variant-file" && hasValue) {
+            variantFile = argv[++i];
+        } else if (arg == "--bank" && hasValue) {
+            bankName = argv[++i];
+            if (std::find(std::begin(BankModelNames), std::end(BankModelNames), bankName) == std::end(BankModelNames)) {
+                std::cout << "Unknown bank model: " << bankName << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--simulate" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            simulateGames = value.value;
+        } else if (arg == "--check-allocations" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 0, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            checkGames = value.value;
+            checkAllocations = true;
+        } else if (arg == "--optimize-bank" && hasValue) {
+            // K:P, e.g. 5:0.6
+            std::string_view spec = argv[++i];
+            std::size_t colon = spec.find(':');
+            ParseResult value = parseInt(spec.substr(0, colon), 1, MaxScheduleRounds);
+            const char* targetEnd = spec.data() + spec.size();
+            std::from_chars_result target = colon == std::string_view::npos
+                ? std::from_chars_result{spec.data(), std::errc::invalid_argument}
+                : std::from_chars(spec.data() + colon + 1, targetEnd, solveTarget);
+            if (!value.ok() || target.ec != std::errc() || target.ptr != targetEnd || solveTarget < 0.0 || solveTarget > 1.0) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            solveRound = value.value;
+        } else if (arg == "--analyze" && hasValue) {
+            // R:PRIZES, e.g. 7:0.01,100,75000,1000000
+            std::string_view spec = argv[++i];
+            std::size_t colon = spec.find(':');
+            ParseResult value = parseInt(spec.substr(0, colon), 1, MaxScheduleRounds);
+            if (!value.ok() || colon == std::string_view::npos) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            analyzeRound = value.value;
+            analyzePrizes = std::string(spec.substr(colon + 1));
+        } else if (arg == "--swap-policy" && hasValue) {
+            std::string_view name = argv[++i];
+            auto found = std::find(std::begin(SwapPolicyNames), std::end(SwapPolicyNames), name);
+            if (found == std::end(SwapPolicyNames)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            swapPolicy = static_cast<SwapPolicy>(found - std::begin(SwapPolicyNames));
+        } else if (arg == "--player" && hasValue) {
+            playerName = argv[++i];
+            if (playerName != "optimal" && std::find(std::begin(PlayerPolicyNames), std::end(PlayerPolicyNames),
+                                                     playerName) == std::end(PlayerPolicyNames)) {
+                std::cout << "Unknown player: " << playerName << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--profile" && hasValue) {
+            std::string_view format = argv[++i];
+            if (format != "table" && format != "json") {
+                printUsage(argv[0]);
+                return 1;
+            }
+            if (!instrument::Enabled) {
+                std::cout << "--profile needs a build with -DDEALMASTER_INSTRUMENT=1" << std::endl;
+                return 1;
+            }
+            profileAsJson = format == "json";
+            std::atexit(dumpProfile);
+        } else if (arg == "--metrics" && hasValue) {
+            metricsPath = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            tracePath = argv[++i];
+        } else if (arg == "--archive" && hasValue) {
+            archivePath = argv[++i];
+        } else if (arg == "--game" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            replayGame = value.value;
+        } else if (arg == "--round" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 0, replay::MaxRounds);
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            replayRound = value.value;
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+    
     try {
-        GameMenu menu;
-        menu.run();
+        // Closed (and the file completed) when main returns
+        trace::TraceWriter tracer;
+        if (!tracePath.empty()) {
+            if (!tracer.open(tracePath)) {
+                throw GameException("Cannot open trace file: " + tracePath);
+            }
+            trace::nameThread("main");
+        }
+        metrics::MetricsWriter metricsFile;
+        if (!metricsPath.empty() && !metricsFile.open(metricsPath)) {
+            throw GameException("Cannot write metrics file: " + metricsPath);
+        }
+        
+        if (!replayPath.empty()) {
+            ReplayViewer viewer;
+            if (!archivePath.empty()) {
+                return viewer.exportArchive(replayPath, archivePath);
+            }
+            return viewer.run(replayPath, replayGame, replayRound);
+        }
+        
+        // Every front-end below is instantiated once per compiled board size;
+        // the rules come from the variant's defaults or from a variant file
+        int status = 0;
+        auto play = [&](auto variant, const auto& rules) {
+            using Variant = decltype(variant);
+            const BasicBankModel<Variant::Cases>& bank = *findBankModel<Variant::Cases>(bankName);
+            
+            if (!serveEndpoint.empty()) {
+                status = runServer<Variant>(rules, bank, serveEndpoint, serveThreads, maxSessions,
+                                            cacheMegabytes);
+                return;
+            }
+            
+            int allCores = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+            const BasicPlayerPolicy<Variant::Cases>* player = findPlayerPolicy<Variant::Cases>(playerName);
+            if (analyzeRound > 0) {
+                AnalysisRunner analysis;
+                status = analysis.run<Variant>(rules, bank, player, analyzeRound, analyzePrizes,
+                                               threadsGiven ? serveThreads : allCores);
+                return;
+            }
+            
+            if (solveRound > 0) {
+                if (!player) {
+                    throw GameException("The bank solver needs a contestant model, not the optimal player");
+                }
+                SolverRunner solver;
+                status = solver.run<Variant>(rules, bank, *player, solveRound, solveTarget,
+                                             threadsGiven ? serveThreads : allCores);
+                return;
+            }
+            
+            if (checkAllocations) {
+                AllocationCheck check;
+                status = check.run<Variant>(rules, bank, checkGames, scriptPath, repeat, seed);
+                return;
+            }
+            
+            if (simulateGames > 0) {
+                SimulationRunner simulation;
+                status = simulation.run<Variant>(rules, bank, simulateGames, seed, swapPolicy,
+                                                 threadsGiven ? serveThreads : allCores, archivePath);
+                return;
+            }
+            
+            std::unique_ptr<replay::ReplayWriter> recorder;
+            if (!recordPath.empty()) {
+                // Replay records do not name their variant
+                if (!std::is_same<Variant, StandardVariant>::value || !rules.builtin) {
+                    throw GameException("Replay logs can only record the built-in standard variant");
+                }
+                recorder = std::make_unique<replay::ReplayWriter>(recordPath);
+                if (!recorder->isOpen()) {
+                    throw GameException("Cannot open replay log: " + recordPath);
+                }
+            }
+            
+            if (!scriptPath.empty()) {
+                BatchRunner batch;
+                status = batch.run<Variant>(rules, bank, scriptPath, repeat, seed, recorder.get());
+                return;
+            }
+            
+            GameMenu<Variant> menu(rules, bank, recorder.get());
+            menu.run();
+        };
+        
+        if (!variantFile.empty()) {
+            VariantSpec spec;
+            std::string error;
+            bool loaded;
+            {
+                trace::Span span("load variant", "io");
+                loaded = loadVariantFile(variantFile, spec, error);
+            }
+            if (!loaded) {
+                throw GameException("Invalid variant file: " + error);
+            }
+            withLoadedRules(spec, play);
+            return status;
+        }
+        
+        if (!withBuiltinRules(variantName, play)) {
+            std::cout << "Unknown variant: " << variantName << std::endl;
+            printUsage(argv[0]);
+            return 1;
+        }
+        return status;
     } catch (const std::exception& e) {
         std::cout << "Fatal Error: " << e.what() << std::endl;
         return 1;
     }
-    
-    return 0;
 }
@@ -0,0 +1,390 @@
+#ifndef DEALMASTER_METRICS_H
+#define DEALMASTER_METRICS_H
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+#include "text_writer.h"
+#include "variant_rules.h"
+
+// Live counters for long runs (simulation and the server), exported in the
+// Prometheus text format to a file for node_exporter's textfile collector.
+//
+// Each thread counts into its own cache-line-aligned block with relaxed
+// single-writer stores; the MetricsWriter thread sums the blocks when it
+// writes the file. Nothing is counted until a writer is open, and then the
+// hot paths never share a cache line or take a lock. A thread that exits
+// hands its block (and its counts) to the next new thread, so the totals
+// stay monotonic.
+namespace metrics {
+
+enum class Histogram : std::uint8_t {
+    Decision,       // Computer deal/no-deal decisions
+    Command,        // Server protocol commands
+    Count
+};
+
+inline constexpr int HistogramCount = static_cast<int>(Histogram::Count);
+inline constexpr std::string_view HistogramNames[HistogramCount] = {
+    "dealmaster_decision_seconds", "dealmaster_command_seconds"
+};
+inline constexpr std::string_view HistogramHelp[HistogramCount] = {
+    "Time the computer player takes to decide on an offer.",
+    "Time to handle one server command, reply included."
+};
+
+// Shared state caches (transposition_cache.h)
+enum class Cache : std::uint8_t {
+    Preview,        // The server's next-offer previews
+    Count
+};
+
+inline constexpr int CacheCount = static_cast<int>(Cache::Count);
+inline constexpr std::string_view CacheNames[CacheCount] = {"preview"};
+
+// Upper bounds of the latency buckets in nanoseconds, and as Prometheus labels
+inline constexpr int LatencyBuckets = 12;
+inline constexpr std::uint64_t LatencyBounds[LatencyBuckets] = {
+    100, 250, 500, 1000, 2500, 5000, 10000, 25000, 50000, 100000, 1000000, 10000000
+};
+inline constexpr std::string_view LatencyLabels[LatencyBuckets] = {
+    "1e-07", "2.5e-07", "5e-07", "1e-06", "2.5e-06", "5e-06", "1e-05", "2.5e-05", "5e-05", "0.0001", "0.001", "0.01"
+};
+
+// One thread's counters; only the owning thread writes them
+struct alignas(64) ThreadMetrics {
+    std::atomic<std::uint64_t> games{0};
+    std::atomic<std::uint64_t> offers[MaxScheduleRounds] = {};
+    std::atomic<std::uint64_t> deals[MaxScheduleRounds] = {};
+    std::atomic<std::uint64_t> sessionsOpened{0};
+    std::atomic<std::uint64_t> sessionsClosed{0};
+    std::atomic<std::uint64_t> allocations{0};
+    std::atomic<std::uint64_t> cacheHits[CacheCount] = {};
+    std::atomic<std::uint64_t> cacheMisses[CacheCount] = {};
+    std::atomic<std::uint64_t> cacheStores[CacheCount] = {};
+    std::atomic<std::uint64_t> latency[HistogramCount][LatencyBuckets + 1] = {};   // Last bucket is +Inf
+    std::atomic<std::uint64_t> latencySum[HistogramCount] = {};
+    std::atomic<bool> owned{true};
+    ThreadMetrics* next = nullptr;
+};
+
+// Single-writer increment: a plain add, no locked instruction
+inline void bump(std::atomic<std::uint64_t>& counter, std::uint64_t amount = 1) {
+    counter.store(counter.load(std::memory_order_relaxed) + amount, std::memory_order_relaxed);
+}
+
+namespace detail {
+
+inline std::atomic<bool> active{false};
+inline std::atomic<ThreadMetrics*> blocks{nullptr};
+
+// Claim a block another thread has given back, or add a new one. Blocks
+// come from malloc, not new: the allocation counter in operator new calls
+// this on a thread's first allocation.
+inline ThreadMetrics* claimBlock() {
+    for (ThreadMetrics* block = blocks.load(std::memory_order_acquire); block; block = block->next) {
+        bool expected = false;
+        if (block->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) return block;
+    }
+    std::size_t space = sizeof(ThreadMetrics) + alignof(ThreadMetrics);
+    void* memory = std::malloc(space);
+    if (!memory) std::abort();
+    void* aligned = std::align(alignof(ThreadMetrics), sizeof(ThreadMetrics), memory, space);
+    ThreadMetrics* block = new (aligned) ThreadMetrics();
+    block->next = blocks.load(std::memory_order_relaxed);
+    while (!blocks.compare_exchange_weak(block->next, block, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return block;
+}
+
+// The calling thread's block, returned when the thread exits
+class BlockLease {
+private:
+    ThreadMetrics* block = nullptr;
+
+public:
+    ~BlockLease() {
+        if (block) block->owned.store(false, std::memory_order_release);
+        block = nullptr;
+    }
+
+    ThreadMetrics& get() {
+        if (!block) block = claimBlock();
+        return *block;
+    }
+};
+
+inline thread_local BlockLease lease;
+
+} // namespace detail
+
+inline bool enabled() {
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+// The calling thread's counters; only call while enabled()
+inline ThreadMetrics& local() {
+    return detail::lease.get();
+}
+
+inline std::uint64_t now() {
+    return static_cast<std::uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
+
+inline void recordLatency(ThreadMetrics& block, Histogram which, std::uint64_t nanoseconds) {
+    int histogram = static_cast<int>(which);
+    int bucket = 0;
+    while (bucket < LatencyBuckets && nanoseconds > LatencyBounds[bucket]) bucket++;
+    bump(block.latency[histogram][bucket]);
+    bump(block.latencySum[histogram], nanoseconds);
+}
+
+// Called by the replacement operator new of the program
+inline void countAllocation() {
+    if (enabled()) bump(local().allocations);
+}
+
+// Times its scope into a latency histogram while metrics are on
+class ScopedLatency {
+private:
+    Histogram histogram;
+    std::uint64_t started;
+
+public:
+    explicit ScopedLatency(Histogram which) : histogram(which), started(enabled() ? now() : 0) {}
+
+    ~ScopedLatency() {
+        if (started != 0) recordLatency(local(), histogram, now() - started);
+    }
+
+    ScopedLatency(const ScopedLatency&) = delete;
+    ScopedLatency& operator=(const ScopedLatency&) = delete;
+};
+
+// Sum of every thread's block
+struct Totals {
+    std::uint64_t games = 0;
+    std::uint64_t offers[MaxScheduleRounds] = {};
+    std::uint64_t deals[MaxScheduleRounds] = {};
+    std::uint64_t sessionsOpened = 0;
+    std::uint64_t sessionsClosed = 0;
+    std::uint64_t allocations = 0;
+    std::uint64_t cacheHits[CacheCount] = {};
+    std::uint64_t cacheMisses[CacheCount] = {};
+    std::uint64_t cacheStores[CacheCount] = {};
+    std::uint64_t latency[HistogramCount][LatencyBuckets + 1] = {};
+    std::uint64_t latencySum[HistogramCount] = {};
+};
+
+inline void collect(Totals& totals) {
+    totals = Totals();
+    for (ThreadMetrics* block = detail::blocks.load(std::memory_order_acquire); block; block = block->next) {
+        totals.games += block->games.load(std::memory_order_relaxed);
+        for (int r = 0; r < MaxScheduleRounds; r++) {
+            totals.offers[r] += block->offers[r].load(std::memory_order_relaxed);
+            totals.deals[r] += block->deals[r].load(std::memory_order_relaxed);
+        }
+        totals.sessionsOpened += block->sessionsOpened.load(std::memory_order_relaxed);
+        totals.sessionsClosed += block->sessionsClosed.load(std::memory_order_relaxed);
+        totals.allocations += block->allocations.load(std::memory_order_relaxed);
+        for (int c = 0; c < CacheCount; c++) {
+            totals.cacheHits[c] += block->cacheHits[c].load(std::memory_order_relaxed);
+            totals.cacheMisses[c] += block->cacheMisses[c].load(std::memory_order_relaxed);
+            totals.cacheStores[c] += block->cacheStores[c].load(std::memory_order_relaxed);
+        }
+        for (int h = 0; h < HistogramCount; h++) {
+            for (int b = 0; b <= LatencyBuckets; b++) {
+                totals.latency[h][b] += block->latency[h][b].load(std::memory_order_relaxed);
+            }
+            totals.latencySum[h] += block->latencySum[h].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+// Resident set size in bytes (0 where it cannot be read)
+inline std::uint64_t residentBytes() {
+#ifdef __linux__
+    std::FILE* statm = std::fopen("/proc/self/statm", "r");
+    if (!statm) return 0;
+    unsigned long long size = 0, resident = 0;
+    int fields = std::fscanf(statm, "%llu %llu", &size, &resident);
+    std::fclose(statm);
+    return fields == 2 ? resident * static_cast<std::uint64_t>(sysconf(_SC_PAGESIZE)) : 0;
+#else
+    return 0;
+#endif
+}
+
+// Write `totals` in the Prometheus text exposition format
+inline void format(TextWriter& out, const Totals& totals, double gamesPerSecond) {
+    auto header = [&](std::string_view name, std::string_view type, std::string_view help) {
+        out.put("# HELP ").put(name).put(' ').put(help).put("\n# TYPE ").put(name).put(' ').put(type).put('\n');
+    };
+
+    header("dealmaster_games_total", "counter", "Games finished.");
+    out.put("dealmaster_games_total ").putUnsigned(totals.games).put('\n');
+    header("dealmaster_games_per_second", "gauge", "Games finished per second since the previous write.");
+    out.put("dealmaster_games_per_second ").putFixed(gamesPerSecond, 1).put('\n');
+
+    int rounds = 0;
+    for (int r = 0; r < MaxScheduleRounds; r++) {
+        if (totals.offers[r] > 0) rounds = r + 1;
+    }
+    header("dealmaster_offers_total", "counter", "Bank offers made, by round.");
+    for (int r = 0; r < rounds; r++) {
+        out.put("dealmaster_offers_total{round=\"").putInt(r + 1).put("\"} ").putUnsigned(totals.offers[r]).put('\n');
+    }
+    header("dealmaster_deals_total", "counter", "Offers accepted, by round.");
+    for (int r = 0; r < rounds; r++) {
+        out.put("dealmaster_deals_total{round=\"").putInt(r + 1).put("\"} ").putUnsigned(totals.deals[r]).put('\n');
+    }
+    header("dealmaster_deal_rate", "gauge", "Share of the offers of each round that were accepted.");
+    for (int r = 0; r < rounds; r++) {
+        double rate = static_cast<double>(totals.deals[r]) / static_cast<double>(totals.offers[r]);
+        out.put("dealmaster_deal_rate{round=\"").putInt(r + 1).put("\"} ").putFixed(rate, 6).put('\n');
+    }
+
+    header("dealmaster_sessions_active", "gauge", "Server sessions open.");
+    out.put("dealmaster_sessions_active ").putUnsigned(totals.sessionsOpened - totals.sessionsClosed).put('\n');
+    header("dealmaster_heap_allocations_total", "counter", "Heap allocations through operator new.");
+    out.put("dealmaster_heap_allocations_total ").putUnsigned(totals.allocations).put('\n');
+    header("dealmaster_resident_memory_bytes", "gauge", "Resident set size.");
+    out.put("dealmaster_resident_memory_bytes ").putUnsigned(residentBytes()).put('\n');
+
+    header("dealmaster_cache_lookups_total", "counter", "State cache lookups, by cache and result.");
+    for (int c = 0; c < CacheCount; c++) {
+        out.put("dealmaster_cache_lookups_total{cache=\"").put(CacheNames[c]).put("\",result=\"hit\"} ");
+        out.putUnsigned(totals.cacheHits[c]).put('\n');
+        out.put("dealmaster_cache_lookups_total{cache=\"").put(CacheNames[c]).put("\",result=\"miss\"} ");
+        out.putUnsigned(totals.cacheMisses[c]).put('\n');
+    }
+    header("dealmaster_cache_stores_total", "counter", "Results stored in a state cache.");
+    for (int c = 0; c < CacheCount; c++) {
+        out.put("dealmaster_cache_stores_total{cache=\"").put(CacheNames[c]).put("\"} ");
+        out.putUnsigned(totals.cacheStores[c]).put('\n');
+    }
+
+    for (int h = 0; h < HistogramCount; h++) {
+        std::string_view name = HistogramNames[h];
+        header(name, "histogram", HistogramHelp[h]);
+        std::uint64_t cumulative = 0;
+        for (int b = 0; b <= LatencyBuckets; b++) {
+            cumulative += totals.latency[h][b];
+            out.put(name).put("_bucket{le=\"").put(b < LatencyBuckets ? LatencyLabels[b] : "+Inf").put("\"} ");
+            out.putUnsigned(cumulative).put('\n');
+        }
+        out.put(name).put("_sum ").putFixed(totals.latencySum[h] / 1e9, 9).put('\n');
+        out.put(name).put("_count ").putUnsigned(cumulative).put('\n');
+    }
+}
+
+// Owns the metrics file and the thread that rewrites it. Each write goes
+// to a temporary file renamed over the old one, so the collector never
+// reads half a file.
+class MetricsWriter {
+public:
+    static constexpr int WriteSeconds = 5;
+    static constexpr std::size_t Capacity = 16 * 1024;
+
+private:
+    std::string path;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    std::uint64_t lastGames;
+    std::chrono::steady_clock::time_point lastWrite;
+    char text[Capacity];
+
+    bool write() {
+        Totals totals;
+        collect(totals);
+        auto now = std::chrono::steady_clock::now();
+        double seconds = std::chrono::duration<double>(now - lastWrite).count();
+        double rate = seconds > 0.0 ? (totals.games - lastGames) / seconds : 0.0;
+        lastGames = totals.games;
+        lastWrite = now;
+
+        TextWriter out(text, sizeof(text));
+        format(out, totals, rate);
+        std::string temporary = path + ".tmp";
+        std::FILE* file = std::fopen(temporary.c_str(), "wb");
+        if (!file) return false;
+        bool ok = std::fwrite(text, 1, out.size(), file) == out.size();
+        ok = std::fclose(file) == 0 && ok;
+#ifdef _WIN32
+        std::remove(path.c_str());
+#endif
+        return ok && std::rename(temporary.c_str(), path.c_str()) == 0;
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, std::chrono::seconds(WriteSeconds));
+            if (stopping) break;
+            lock.unlock();
+            write();
+            lock.lock();
+        }
+    }
+
+public:
+    MetricsWriter() : stopping(false), lastGames(0) {}
+
+    MetricsWriter(const MetricsWriter&) = delete;
+    MetricsWriter& operator=(const MetricsWriter&) = delete;
+
+    ~MetricsWriter() {
+        close();
+    }
+
+    // Start counting and write `file` now and every WriteSeconds
+    bool open(const std::string& file) {
+        if (!path.empty() || detail::active.load()) return false;
+        path = file;
+        lastWrite = std::chrono::steady_clock::now();
+        detail::active.store(true, std::memory_order_release);
+        if (!write()) {
+            detail::active.store(false, std::memory_order_release);
+            path.clear();
+            return false;
+        }
+        worker = std::thread([this]() { run(); });
+        return true;
+    }
+
+    // Write the final counts and stop
+    void close() {
+        if (path.empty()) return;
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        write();
+        detail::active.store(false, std::memory_order_release);
+        path.clear();
+    }
+};
+
+} // namespace metrics
+
+#endif // DEALMASTER_METRICS_H
@@ -0,0 +1,183 @@
+#ifndef DEALMASTER_MONEY_H
+#define DEALMASTER_MONEY_H
+
+#include <cstddef>
+#include <cstdint>
+#include <limits>
+#include <string_view>
+
+// Amounts of money are whole cents in 64-bit integers: prizes, offers,
+// payouts and winnings. Sums of cents are exact and do not depend on the
+// order they are added in, so totals are the same on any number of threads.
+// Expected values (the advisor, the solver, the analyzer) are averages
+// weighted by probabilities and stay in floating-point dollars.
+using Cents = std::int64_t;
+
+// Nearest whole number to an amount of cents, halves away from zero
+constexpr Cents roundCents(double cents) {
+    return static_cast<Cents>(cents < 0.0 ? cents - 0.5 : cents + 0.5);
+}
+
+constexpr Cents toCents(double dollars) {
+    return roundCents(dollars * 100.0);
+}
+
+constexpr double toDollars(Cents amount) {
+    return static_cast<double>(amount) / 100.0;
+}
+
+// `amount` scaled by `factor` (an offer multiplier), to the nearest cent
+constexpr Cents scaleCents(Cents amount, double factor) {
+    return roundCents(static_cast<double>(amount) * factor);
+}
+
+// Mean of `count` amounts summing to `total`, to the nearest cent. Exact:
+// the fraction of total / count is a multiple of 1 / count, far more than
+// a rounding error away from one half unless it is one half.
+constexpr Cents meanCents(Cents total, int count) {
+    return roundCents(static_cast<double>(total) / count);
+}
+
+// Parse a decimal amount of dollars as putCents writes it ("1234.50",
+// "-0.01"; "1234.5" and "1234" too) into cents; false if the text is not a
+// plain decimal with at most two places or does not fit
+inline bool parseCents(std::string_view text, Cents& amount) {
+    bool negative = !text.empty() && text[0] == '-';
+    if (negative) text.remove_prefix(1);
+    std::size_t point = text.find('.');
+    std::string_view whole = text.substr(0, point);
+    std::string_view fraction = point == std::string_view::npos ? std::string_view() : text.substr(point + 1);
+    if (whole.empty() || fraction.size() > 2 || (point != std::string_view::npos && fraction.empty())) return false;
+
+    Cents value = 0;
+    auto push = [&](char ch) {
+        if (ch < '0' || ch > '9') return false;
+        Cents digit = ch - '0';
+        if (value > (std::numeric_limits<Cents>::max() - digit) / 10) return false;
+        value = value * 10 + digit;
+        return true;
+    };
+    for (char ch : whole) {
+        if (!push(ch)) return false;
+    }
+    for (std::size_t i = 0; i < 2; i++) {
+        if (!push(i < fraction.size() ? fraction[i] : '0')) return false;
+    }
+    amount = negative ? -value : value;
+    return true;
+}
+
+// Exact 128-bit running total of cents, for sums over billions of games
+// (a 64-bit total of $1,000,000 prizes overflows after 92 billion).
+// Two's complement over a signed high and an unsigned low word.
+class CentsTotal {
+private:
+    std::uint64_t low = 0;
+    std::int64_t high = 0;
+
+    // Magnitude as four 32-bit limbs, most significant first
+    void limbs(std::uint32_t (&digits)[4], bool& negative) const {
+        std::uint64_t lowWord = low;
+        std::uint64_t highWord = static_cast<std::uint64_t>(high);
+        negative = high < 0;
+        if (negative) {
+            lowWord = ~lowWord + 1;
+            highWord = ~highWord + (lowWord == 0 ? 1 : 0);
+        }
+        digits[0] = static_cast<std::uint32_t>(highWord >> 32);
+        digits[1] = static_cast<std::uint32_t>(highWord);
+        digits[2] = static_cast<std::uint32_t>(lowWord >> 32);
+        digits[3] = static_cast<std::uint32_t>(lowWord);
+    }
+
+public:
+    void add(Cents amount) {
+        std::uint64_t before = low;
+        low += static_cast<std::uint64_t>(amount);
+        high += (amount < 0 ? -1 : 0) + (low < before ? 1 : 0);
+    }
+
+    void merge(const CentsTotal& other) {
+        std::uint64_t before = low;
+        low += other.low;
+        high += other.high + (low < before ? 1 : 0);
+    }
+
+    bool operator==(const CentsTotal& other) const {
+        return low == other.low && high == other.high;
+    }
+
+    bool operator!=(const CentsTotal& other) const {
+        return !(*this == other);
+    }
+
+    // The total in dollars, rounded only at this last step
+    double dollars() const {
+        return (static_cast<double>(high) * 18446744073709551616.0 + static_cast<double>(low)) / 100.0;
+    }
+
+    // Exact decimal dollars, e.g. "-1234.50"; `buffer` needs 44 bytes
+    std::string_view format(char* buffer) const {
+        std::uint32_t digits[4];
+        bool negative;
+        limbs(digits, negative);
+        char* end = buffer + 44;
+        char* position = end;
+        int written = 0;
+        bool zero;
+        do {
+            // Divide the magnitude by 10 in place; the remainder is the next digit
+            std::uint64_t remainder = 0;
+            zero = true;
+            for (std::uint32_t& digit : digits) {
+                std::uint64_t value = (remainder << 32) | digit;
+                digit = static_cast<std::uint32_t>(value / 10);
+                remainder = value % 10;
+                if (digit != 0) zero = false;
+            }
+            *--position = static_cast<char>('0' + remainder);
+            if (++written == 2) *--position = '.';
+        } while (!zero || written < 3);
+        if (negative) *--position = '-';
+        return std::string_view(position, static_cast<std::size_t>(end - position));
+    }
+
+    // Parse what format() writes ("1234.5" and "1234" too); false if the
+    // text is not a plain decimal with at most two places
+    bool parse(std::string_view text) {
+        *this = CentsTotal();
+        bool negative = !text.empty() && text[0] == '-';
+        if (negative) text.remove_prefix(1);
+        std::size_t point = text.find('.');
+        std::string_view whole = text.substr(0, point);
+        std::string_view fraction = point == std::string_view::npos ? std::string_view() : text.substr(point + 1);
+        if (whole.empty() || fraction.size() > 2 || (point != std::string_view::npos && fraction.empty())) return false;
+
+        std::uint32_t digits[4] = {};
+        auto push = [&](char ch) {
+            if (ch < '0' || ch > '9') return false;
+            std::uint64_t carry = static_cast<std::uint64_t>(ch - '0');
+            for (int i = 3; i >= 0; i--) {
+                std::uint64_t value = static_cast<std::uint64_t>(digits[i]) * 10 + carry;
+                digits[i] = static_cast<std::uint32_t>(value);
+                carry = value >> 32;
+            }
+            return carry == 0 && digits[0] < 0x80000000u;
+        };
+        for (char ch : whole) {
+            if (!push(ch)) return false;
+        }
+        for (std::size_t i = 0; i < 2; i++) {
+            if (!push(i < fraction.size() ? fraction[i] : '0')) return false;
+        }
+        low = (static_cast<std::uint64_t>(digits[2]) << 32) | digits[3];
+        high = static_cast<std::int64_t>((static_cast<std::uint64_t>(digits[0]) << 32) | digits[1]);
+        if (negative) {
+            low = ~low + 1;
+            high = static_cast<std::int64_t>(~static_cast<std::uint64_t>(high) + (low == 0 ? 1 : 0));
+        }
+        return true;
+    }
+};
+
+#endif // DEALMASTER_MONEY_H
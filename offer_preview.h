@@ -0,0 +1,215 @@
+#ifndef DEALMASTER_OFFER_PREVIEW_H
+#define DEALMASTER_OFFER_PREVIEW_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "bit_ops.h"
+#include "bank_model.h"
+#include "game_variants.h"
+#include "money.h"
+#include "transposition_cache.h"
+#include "variant_rules.h"
+
+// Distribution of the bank's next offer over every way the cases opened
+// before it could fall, each equally likely
+struct OfferPreview {
+    static constexpr int Bands = 4;
+
+    int round = 0;                  // Round whose offer is previewed
+    int casesToOpen = 0;            // Cases still to open before it
+    std::uint32_t ways = 0;         // Sets of prizes they could take out
+    Cents low = 0;
+    Cents median = 0;               // Lower median
+    Cents high = 0;
+    double mean = 0.0;
+
+    // Against the offer on the table, when there is one
+    Cents current = 0;
+    double beats = 0.0;             // P(the next offer is higher)
+    double band[Bands] = {};        // P(below 50%, 50-100%, 100-150%, above 150% of it)
+};
+
+// The k-subsets of {0, ..., n-1} in revolving-door order (Knuth, TAOCP
+// 7.2.1.3, Algorithm R): each set differs from the one before by a single
+// element swapped out for another, so running sums over the set cost one
+// subtraction and one addition per step. Starts at {0, ..., k-1}.
+class RevolvingDoor {
+private:
+    int c[MaxVariantCases + 2];     // c[1..k] ascending, c[k+1] = n
+    int k;
+
+public:
+    RevolvingDoor(int n, int size) : c{}, k(size) {
+        for (int j = 1; j <= k; j++) c[j] = j - 1;
+        c[k + 1] = n;
+    }
+
+    // Step to the next set, which has `out` replaced by `in`; false after
+    // the last set
+    bool next(int& out, int& in) {
+        if (k == 0) return false;
+        if (k & 1) {
+            if (c[1] + 1 < c[2]) {
+                out = c[1];
+                in = ++c[1];
+                return true;
+            }
+        } else if (c[1] > 0) {
+            out = c[1];
+            in = --c[1];
+            return true;
+        }
+        // Odd sizes go on by decreasing c[2], even ones by increasing it,
+        // alternating up the elements
+        bool decrease = (k & 1) != 0;
+        for (int j = 2; j <= k; j++, decrease = !decrease) {
+            if (decrease) {
+                // Here c[j] = c[j-1] + 1
+                if (c[j] >= j) {
+                    out = c[j];
+                    in = j - 2;
+                    c[j] = c[j - 1];
+                    c[j - 1] = j - 2;
+                    return true;
+                }
+            } else if (c[j] + 1 < c[j + 1]) {
+                // Here c[j-1] = j - 2
+                out = c[j - 1];
+                in = c[j] + 1;
+                c[j - 1] = c[j];
+                c[j]++;
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+// The next offer over all C(n, k) ways the k cases still to be opened
+// before `round`'s offer could take prizes out of the n in play. The
+// player's case is as unknown as the others, so from the player's side
+// every k of the n prizes are equally likely to go, the case among them.
+// The opened sets are walked in revolving-door order with the mask and sum
+// of the prizes that stay kept up to date, and models that price by total
+// skip the mask: the opening round of the standard show, C(26, 6), takes a
+// few milliseconds. Offers are kept in a per-thread buffer for the median.
+// False if no offer comes after the cases are opened.
+template <int N>
+bool previewNextOffer(const BasicGameRules<N>& rules, const BasicBankModel<N>& bank, int round,
+                      CaseMask<N> inPlay, int casesToOpen, Cents current, OfferPreview& result) {
+    using Mask = CaseMask<N>;
+    result = OfferPreview();
+    int prizes = popcount32(inPlay);
+    int stay = prizes - casesToOpen;
+    if (round < 1 || round > rules.rounds || casesToOpen < 0 || stay < 2) return false;
+
+    int board[N];
+    int count = 0;
+    for (int i = 0; i < N; i++) {
+        if ((inPlay >> i) & 1u) board[count++] = i;
+    }
+    Mask kept = inPlay;
+    Cents keptTotal = 0;
+    for (int j = 0; j < prizes; j++) keptTotal += rules.board.cents[board[j]];
+    for (int j = 0; j < casesToOpen; j++) {
+        kept = static_cast<Mask>(kept & ~(1u << board[j]));
+        keptTotal -= rules.board.cents[board[j]];
+    }
+
+    thread_local std::vector<Cents> offers;
+    offers.clear();
+    bool byTotal = bank.pricesByTotal();
+    Cents total = 0;
+    Cents halfOffer = current / 2;
+    Cents bandEdge[OfferPreview::Bands - 1] = {halfOffer, current, current + halfOffer};
+    std::uint32_t bandCount[OfferPreview::Bands] = {};
+    std::uint32_t higher = 0;
+    RevolvingDoor opened(prizes, casesToOpen);
+    int out;
+    int in;
+    while (true) {
+        Cents offer = byTotal ? bank.offerForTotal(rules, round, keptTotal, stay) : bank.offer(rules, round, kept);
+        offers.push_back(offer);
+        total += offer;
+        higher += offer > current;
+        int band = 0;
+        while (band < OfferPreview::Bands - 1 && offer >= bandEdge[band]) band++;
+        bandCount[band]++;
+
+        // The prize leaving the opened set stays in play; the one joining it goes
+        if (!opened.next(out, in)) break;
+        kept = static_cast<Mask>(kept ^ (1u << board[out]) ^ (1u << board[in]));
+        keptTotal += rules.board.cents[board[out]] - rules.board.cents[board[in]];
+    }
+
+    result.round = round;
+    result.casesToOpen = casesToOpen;
+    result.ways = static_cast<std::uint32_t>(offers.size());
+    auto middle = offers.begin() + (offers.size() - 1) / 2;
+    std::nth_element(offers.begin(), middle, offers.end());
+    result.median = *middle;
+    auto range = std::minmax_element(offers.begin(), offers.end());
+    result.low = *range.first;
+    result.high = *range.second;
+    result.mean = toDollars(total) / result.ways;
+    result.current = current;
+    if (current > 0) {
+        result.beats = static_cast<double>(higher) / result.ways;
+        for (int band = 0; band < OfferPreview::Bands; band++) {
+            result.band[band] = static_cast<double>(bandCount[band]) / result.ways;
+        }
+    }
+    return true;
+}
+
+// Previews shared across games, keyed by the round previewed, the prizes in
+// play, the cases to open before it and whether an offer is on the table
+using OfferPreviewCache = TranspositionCache<OfferPreview>;
+
+// Previews of fewer ways are cheaper to redo than to look up
+inline constexpr std::uint64_t MinCachedWays = 64;
+
+// C(n, k), the ways a preview walks
+inline std::uint64_t previewWays(int n, int k) {
+    std::uint64_t ways = 1;
+    for (int i = 1; i <= k; i++) ways = ways * static_cast<std::uint64_t>(n - k + i) / static_cast<std::uint64_t>(i);
+    return ways;
+}
+
+// previewNextOffer through `cache` (none if null). For one bank the offer
+// on the table is a function of the state, so it is not part of the key;
+// an entry made against a different offer is recomputed.
+template <int N>
+bool previewNextOffer(const BasicGameRules<N>& rules, const BasicBankModel<N>& bank, OfferPreviewCache* cache,
+                      int round, CaseMask<N> inPlay, int casesToOpen, Cents current, OfferPreview& result) {
+    int prizes = popcount32(inPlay);
+    if (!cache || casesToOpen < 0 || casesToOpen > prizes || previewWays(prizes, casesToOpen) < MinCachedWays) {
+        return previewNextOffer(rules, bank, round, inPlay, casesToOpen, current, result);
+    }
+    std::uint64_t key = static_cast<std::uint64_t>(inPlay) | static_cast<std::uint64_t>(round) << 32
+                      | static_cast<std::uint64_t>(casesToOpen) << 40 | static_cast<std::uint64_t>(current != 0) << 48;
+    if (cache->lookup(key, result) && result.current == current) return true;
+    if (!previewNextOffer(rules, bank, round, inPlay, casesToOpen, current, result)) return false;
+    cache->store(key, result, result.ways);
+    return true;
+}
+
+// The preview as advisor lines (`out` is a FrameBuffer or TextWriter)
+template <class Writer>
+void writeOfferPreview(Writer& out, const OfferPreview& preview) {
+    out.put("Next offer (round ").putInt(preview.round).put(", after ").putInt(preview.casesToOpen);
+    out.put(preview.casesToOpen == 1 ? " more case, " : " more cases, ").putInt(preview.ways).put(" ways):\n");
+    out.put("  Range $").putCents(preview.low).put(" - $").putCents(preview.high);
+    out.put(", median $").putCents(preview.median).put(", mean $").putFixed(preview.mean, 2).put('\n');
+    if (preview.current <= 0) return;
+    out.put("  Beats this offer: ").putFixed(preview.beats * 100, 1).put("%\n");
+    out.put("  Under 50% of it: ").putFixed(preview.band[0] * 100, 1);
+    out.put("%  50-100%: ").putFixed(preview.band[1] * 100, 1);
+    out.put("%  100-150%: ").putFixed(preview.band[2] * 100, 1);
+    out.put("%  Over 150%: ").putFixed(preview.band[3] * 100, 1).put("%\n");
+}
+
+#endif // DEALMASTER_OFFER_PREVIEW_H
@@ -0,0 +1,95 @@
+#ifndef DEALMASTER_PLAYER_POLICY_H
+#define DEALMASTER_PLAYER_POLICY_H
+
+#include <cmath>
+#include <string_view>
+
+#include "computer_player.h"
+#include "game_variants.h"
+#include "prize_board.h"
+#include "prize_ranks.h"
+
+// How a contestant answers an offer, as seen by the bank: the probability
+// of taking the deal given the round, the prizes still in play (a mask over
+// board indices) and the offer. Deterministic players return 0 or 1.
+// Policies are stateless, so one shared instance serves every solver
+// thread.
+template <int N>
+class BasicPlayerPolicy {
+public:
+    using Mask = CaseMask<N>;
+
+    virtual ~BasicPlayerPolicy() = default;
+
+    virtual const char* name() const = 0;
+
+    virtual double acceptProbability(const BasicPrizeBoard<N>& board, int round, Mask remaining,
+                                     double offer) const = 0;
+};
+
+// The built-in ComputerPlayer, exactly as it plays
+template <int N>
+class ComputerPlayerPolicy : public BasicPlayerPolicy<N> {
+public:
+    using typename BasicPlayerPolicy<N>::Mask;
+
+    const char* name() const override {
+        return "computer";
+    }
+
+    double acceptProbability(const BasicPrizeBoard<N>& board, int, Mask remaining, double offer) const override {
+        BasicPrizeRanks<N> prizes(board, remaining);
+        bool deal = ComputerPlayer::shared().shouldAcceptDeal(prizes, offer, prizes.count());
+        return deal ? 1.0 : 0.0;
+    }
+};
+
+// Contestants who deal with a probability rising smoothly in offer / EV,
+// 50% at Midpoint, and a little more readily each round as the stakes
+// firm up. The coefficients are a hand-set starting point; refit them from
+// recorded shows before trusting the solver's schedules for real players.
+template <int N>
+class LogisticPlayerPolicy : public BasicPlayerPolicy<N> {
+public:
+    using typename BasicPlayerPolicy<N>::Mask;
+
+    static constexpr double Midpoint = 0.85;
+    static constexpr double Slope = 12.0;
+    static constexpr double RoundShift = 0.02;      // Midpoint drop per round
+
+    const char* name() const override {
+        return "logistic";
+    }
+
+    double acceptProbability(const BasicPrizeBoard<N>& board, int round, Mask remaining,
+                             double offer) const override {
+        double sum = 0.0;
+        int count = 0;
+        for (int i = 0; i < N; i++) {
+            if ((remaining >> i) & 1u) {
+                sum += board.value[i];
+                count++;
+            }
+        }
+        if (count == 0 || sum <= 0.0) return 1.0;
+        double ratio = offer / (sum / count);
+        double midpoint = Midpoint - RoundShift * (round - 1);
+        return 1.0 / (1.0 + std::exp(-Slope * (ratio - midpoint)));
+    }
+};
+
+inline constexpr std::string_view PlayerPolicyNames[] = {"computer", "logistic"};
+
+// The shared instance of the policy called `name`, or nullptr
+template <int N>
+const BasicPlayerPolicy<N>* findPlayerPolicy(std::string_view name) {
+    static const ComputerPlayerPolicy<N> computer;
+    static const LogisticPlayerPolicy<N> logistic;
+    const BasicPlayerPolicy<N>* policies[] = {&computer, &logistic};
+    for (const BasicPlayerPolicy<N>* policy : policies) {
+        if (name == policy->name()) return policy;
+    }
+    return nullptr;
+}
+
+#endif // DEALMASTER_PLAYER_POLICY_H
@@ -0,0 +1,345 @@
+#ifndef DEALMASTER_POSITION_ANALYZER_H
+#define DEALMASTER_POSITION_ANALYZER_H
+
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "bit_ops.h"
+#include "bank_model.h"
+#include "game_variants.h"
+#include "player_policy.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+// Exact analysis of one mid-game position. Per-round arrays are indexed by
+// round - 1 and hold values only for the rounds still to come.
+template <int N>
+struct BasicPositionAnalysis {
+    int round = 0;                  // Round whose offer comes next
+    int prizesInPlay = 0;           // Including the player's own case
+    bool offerOnTable = false;      // The offer of `round` is made and unanswered
+    double offer = 0.0;             // ...and this is it
+    double prizeMean = 0.0;         // Payout when every offer is refused
+
+    // Risk-neutral optimum. optimalFrom[r] is the expected payout of
+    // refusing every offer before round r and playing optimally from there,
+    // so optimalFrom[round] is the value of the position itself.
+    double optimalValue = 0.0;
+    double expectedOffer[MaxScheduleRounds] = {};   // Mean offer of round r, dealing then whatever comes
+    double optimalFrom[MaxScheduleRounds] = {};
+
+    // Outcome distribution under the chosen player
+    const char* player = "";
+    double playerValue = 0.0;
+    double playerDeviation = 0.0;
+    double dealProbability[MaxScheduleRounds] = {};
+    double dealMean[MaxScheduleRounds] = {};        // Mean accepted offer, given a deal in round r
+    double prizeProbability[N] = {};                // P(no deal and the player's case holds board prize i)
+};
+
+// Answers "what if" questions about any reachable position: the prizes
+// still in play (the player's case among them, its contents unknown) and
+// the round whose offer comes next.
+//
+// Construction memoizes the optimal expected payout of every subset of the
+// board, max(offer, mean over the next opened case), in one pass up from
+// the final pairs, and the chosen player's answer to every offer. Neither
+// depends on the position, so a query
+// only runs down from its own prizes: the chance of every subset being in
+// play at each later offer with no deal yet, one opened case at a time. Down
+// to the first offer nothing has been decided, so that level is uniform.
+//
+// Both passes sweep masks in numeric order, which puts every subset after
+// (or, going down, before) all the sets it is built from, so one pass in
+// order covers every level. Masks go 2^BlockBits at a time; blocks that
+// differ in the same number of high bits do not depend on each other and
+// run in parallel. Queries reuse one buffer and must not run concurrently.
+template <class Variant>
+class PositionAnalyzer {
+public:
+    static constexpr int Cases = Variant::Cases;
+    using Mask = CaseMask<Cases>;
+    using Rules = BasicGameRules<Cases>;
+    using Analysis = BasicPositionAnalysis<Cases>;
+
+private:
+    static constexpr int BlockBits = 16;
+    static constexpr int HalfBits = (Cases + 1) / 2;
+
+    // Per-thread sums of one offer level
+    struct LevelSums {
+        double offer;
+        double optimal;
+        double deal;
+        double dealPayout;
+        double dealSquares;
+    };
+
+    struct alignas(64) PartSums {
+        LevelSums round[MaxScheduleRounds];
+        double prize[Cases];
+    };
+
+    // Maps the masks over the prizes of one set (bit j: the set's j-th
+    // prize) to board masks and to their rank among board masks of the same
+    // size. The low and high halves each take one table lookup.
+    class SubsetIndex {
+    private:
+        std::vector<Mask> lowMask;
+        std::vector<Mask> highMask;
+        std::vector<std::uint32_t> lowRank;
+        std::vector<std::uint32_t> highRank;    // [prizes in the low half][high half]
+
+    public:
+        void build(const MaskRanker<Cases>& ranker, Mask set) {
+            int prizes[Cases];
+            int count = 0;
+            for (int i = 0; i < Cases; i++) {
+                if ((set >> i) & 1u) prizes[count++] = i;
+            }
+            int lowBits = std::min(count, HalfBits);
+            int highBits = count - lowBits;
+
+            lowMask.assign(std::size_t(1) << lowBits, 0);
+            lowRank.assign(std::size_t(1) << lowBits, 0);
+            for (std::size_t local = 1; local < lowMask.size(); local++) {
+                int j = countTrailingZeros(local);
+                lowMask[local] = static_cast<Mask>(lowMask[local & (local - 1)] | (1u << prizes[j]));
+                lowRank[local] = ranker.rank(lowMask[local]);
+            }
+
+            // The k-th set bit of the high half is bit (low count + k) of the mask
+            std::size_t highSize = std::size_t(1) << highBits;
+            highMask.assign(highSize, 0);
+            highRank.assign((HalfBits + 1) * highSize, 0);
+            for (std::size_t local = 0; local < highSize; local++) {
+                int k = 0;
+                for (int j = 0; j < highBits; j++) {
+                    if (!((local >> j) & 1u)) continue;
+                    highMask[local] = static_cast<Mask>(highMask[local] | (1u << prizes[lowBits + j]));
+                    k++;
+                    for (int below = 0; below <= lowBits; below++) {
+                        highRank[below * highSize + local] += ranker.binomial(prizes[lowBits + j], below + k);
+                    }
+                }
+            }
+        }
+
+        Mask mask(std::uint32_t local) const {
+            return static_cast<Mask>(lowMask[local & (lowMask.size() - 1)] | highMask[local >> HalfBits]);
+        }
+
+        std::uint32_t rank(std::uint32_t local) const {
+            std::uint32_t low = local & static_cast<std::uint32_t>(lowMask.size() - 1);
+            return lowRank[low] + highRank[popcount32(low) * highMask.size() + (local >> HalfBits)];
+        }
+    };
+
+    const Rules& rules;
+    const BasicPlayerPolicy<Cases>* player;     // nullptr: the optimal player
+    BasicOfferTable<Cases> offers;
+    int threads;
+    int offerRound[Cases + 1];                  // Round whose offer is made with k prizes in play, or 0
+    SubsetIndex board;
+    SubsetIndex index;
+    std::vector<double> optimal;                // Optimal expected payout by board mask, at its offer
+    std::vector<double> acceptance[MaxScheduleRounds];  // P(deal) per offer, in offer table order
+    std::vector<double> weight;                 // P(in play, no deal yet) by mask over the position's prizes
+    std::vector<PartSums> sums;
+
+    const MaskRanker<Cases>& ranker() const {
+        return offers.masks();
+    }
+
+    double mean(Mask mask) const {
+        Cents sum = 0;
+        int count = 0;
+        for (int i = 0; i < Cases; i++) {
+            if ((mask >> i) & 1u) {
+                sum += rules.board.cents[i];
+                count++;
+            }
+        }
+        return count > 0 ? toDollars(sum) / count : 0.0;
+    }
+
+    // Call work(part, mask) for every mask below 1 << bits, each after all
+    // its subsets (`up`) or all its supersets
+    template <class Work>
+    void sweep(int bits, bool up, const Work& work) const {
+        int blockBits = std::min(bits, BlockBits);
+        int highBits = bits - blockBits;
+        std::uint32_t blockSize = 1u << blockBits;
+        for (int step = 0; step <= highBits; step++) {
+            int level = up ? step : highBits - step;
+            forEachMaskInParallel(ranker(), highBits, level, threads, [&](int part, Mask high, std::uint32_t) {
+                std::uint32_t first = static_cast<std::uint32_t>(high) << blockBits;
+                if (up) {
+                    for (std::uint32_t low = 0; low < blockSize; low++) work(part, first | low);
+                } else {
+                    for (std::uint32_t low = blockSize; low-- > 0;) work(part, first | low);
+                }
+            }, 1);
+        }
+    }
+
+public:
+    // `policy` is the contestant whose outcomes are reported; nullptr plays
+    // to maximise the expected payout
+    PositionAnalyzer(const Rules& gameRules, const BasicBankModel<Cases>& bank,
+                     const BasicPlayerPolicy<Cases>* policy, int threadCount)
+        : rules(gameRules), player(policy), threads(std::max(1, threadCount)), offerRound{},
+          optimal(std::size_t(1) << Cases), weight(std::size_t(1) << Cases),
+          sums(static_cast<std::size_t>(std::max(1, threadCount))) {
+        offers.bake(bank, rules);
+        for (int r = 1; r <= rules.rounds; r++) {
+            offerRound[offers.prizesInPlay(r)] = r;
+            acceptance[r - 1].resize(ranker().binomial(Cases, offers.prizesInPlay(r)));
+        }
+        board.build(ranker(), rules.board.allMask);
+
+        int first = offers.prizesInPlay(1);
+        int final = offers.prizesInPlay(rules.rounds);
+        trace::Span span("optimal values", "analyzer");
+        sweep(Cases, true, [&](int, std::uint32_t mask) {
+            int bits = popcount32(mask);
+            if (bits < final || bits > first) return;
+
+            // After the last offer the player's case is equally likely to be any prize left
+            double later = 0.0;
+            if (bits == final) {
+                later = mean(static_cast<Mask>(mask));
+            } else {
+                for (std::uint32_t rest = mask; rest != 0; rest &= rest - 1) {
+                    later += optimal[mask ^ (rest & (~rest + 1))];
+                }
+                later /= bits;
+            }
+            int round = offerRound[bits];
+            if (round == 0) {
+                optimal[mask] = later;
+                return;
+            }
+            std::uint32_t rank = board.rank(mask);
+            double offer = toDollars(offers.roundOffers(round)[rank]);
+            optimal[mask] = std::max(offer, later);
+            acceptance[round - 1][rank] = player
+                ? player->acceptProbability(rules.board, round, static_cast<Mask>(mask), offer)
+                : (offer >= later ? 1.0 : 0.0);
+        });
+    }
+
+    const char* playerName() const {
+        return player ? player->name() : "optimal";
+    }
+
+    // Analyse the position with the prizes in `position` in play before the
+    // offer of `round`; false with `error` set if no game reaches it
+    bool analyze(Mask position, int round, Analysis& result, std::string& error) {
+        trace::Span span("analyze", "analyzer", "round", round);
+        int prizes = popcount32(position);
+        if ((position & ~rules.board.allMask) != 0) {
+            error = "prizes not on the board";
+            return false;
+        }
+        if (round < 1 || round > rules.rounds) {
+            error = "the variant has rounds 1 to " + std::to_string(rules.rounds);
+            return false;
+        }
+        int first = offers.prizesInPlay(round);
+        int most = round > 1 ? offers.prizesInPlay(round - 1) : Cases;
+        if (prizes < first || prizes > most) {
+            error = "round " + std::to_string(round) + " is played with " + std::to_string(first) + " to "
+                  + std::to_string(most) + " prizes in play";
+            return false;
+        }
+
+        result = Analysis();
+        result.round = round;
+        result.prizesInPlay = prizes;
+        result.offerOnTable = prizes == first;
+        result.prizeMean = mean(position);
+        result.player = playerName();
+
+        index.build(ranker(), position);
+        for (PartSums& part : sums) part = PartSums();
+        int final = offers.prizesInPlay(rules.rounds);
+        double even = 1.0 / ranker().binomial(prizes, first);
+        std::uint32_t all = static_cast<std::uint32_t>((std::uint64_t(1) << prizes) - 1);
+
+        sweep(prizes, false, [&](int part, std::uint32_t local) {
+            int bits = popcount32(local);
+            if (bits < final || bits > first) return;
+
+            // Each set one prize larger opens one of its cases at random
+            double chance = even;
+            if (bits < first) {
+                chance = 0.0;
+                for (std::uint32_t free = all & ~local; free != 0; free &= free - 1) {
+                    chance += weight[local | (free & (~free + 1))];
+                }
+                chance /= bits + 1;
+            }
+            int r = offerRound[bits];
+            if (r == 0) {
+                weight[local] = chance;
+                return;
+            }
+
+            LevelSums& sum = sums[part].round[r - 1];
+            Mask mask = index.mask(local);
+            std::uint32_t rank = index.rank(local);
+            double offer = toDollars(offers.roundOffers(r)[rank]);
+            sum.offer += offer;
+            sum.optimal += optimal[mask];
+
+            double deal = chance * acceptance[r - 1][rank];
+            sum.deal += deal;
+            sum.dealPayout += deal * offer;
+            sum.dealSquares += deal * offer * offer;
+            weight[local] = chance - deal;
+            if (bits == final) {
+                double each = (chance - deal) / bits;
+                for (Mask rest = mask; rest != 0; rest = static_cast<Mask>(rest & (rest - 1))) {
+                    sums[part].prize[countTrailingZeros(rest)] += each;
+                }
+            }
+        });
+
+        double secondMoment = 0.0;
+        for (int r = round; r <= rules.rounds; r++) {
+            LevelSums level = {};
+            for (const PartSums& part : sums) {
+                level.offer += part.round[r - 1].offer;
+                level.optimal += part.round[r - 1].optimal;
+                level.deal += part.round[r - 1].deal;
+                level.dealPayout += part.round[r - 1].dealPayout;
+                level.dealSquares += part.round[r - 1].dealSquares;
+            }
+            double count = ranker().binomial(prizes, offers.prizesInPlay(r));
+            result.expectedOffer[r - 1] = level.offer / count;
+            result.optimalFrom[r - 1] = level.optimal / count;
+            result.dealProbability[r - 1] = level.deal;
+            result.dealMean[r - 1] = level.deal > 0.0 ? level.dealPayout / level.deal : 0.0;
+            result.playerValue += level.dealPayout;
+            secondMoment += level.dealSquares;
+        }
+        for (int i = 0; i < Cases; i++) {
+            for (const PartSums& part : sums) result.prizeProbability[i] += part.prize[i];
+            result.playerValue += result.prizeProbability[i] * rules.board.value[i];
+            secondMoment += result.prizeProbability[i] * rules.board.value[i] * rules.board.value[i];
+        }
+
+        result.optimalValue = result.optimalFrom[round - 1];
+        if (result.offerOnTable) result.offer = result.expectedOffer[round - 1];
+        double variance = secondMoment - result.playerValue * result.playerValue;
+        result.playerDeviation = variance > 0.0 ? std::sqrt(variance) : 0.0;
+        return true;
+    }
+};
+
+#endif // DEALMASTER_POSITION_ANALYZER_H
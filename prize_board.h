@@ -0,0 +1,89 @@
+#ifndef DEALMASTER_PRIZE_BOARD_H
+#define DEALMASTER_PRIZE_BOARD_H
+
+#include <cstdint>
+
+#include "game_rules.h"
+#include "game_variants.h"
+#include "money.h"
+
+// Immutable prize board shared by every game and session.
+//
+// One board per set of rules (see variant_rules.h) is built once, at
+// compile time for the built-in variants, and never copied: games keep one-byte prize indices into it
+// (0 = smallest prize) and sets of prizes as bit masks over those indices.
+template <int N>
+struct BasicPrizeBoard {
+    using Mask = CaseMask<N>;
+    static constexpr int Size = N;
+    static constexpr double LowPrizeLimit = 500.0;   // Console splits prizes at this value
+
+    double value[Size];                 // Ascending, in dollars (for display and expectations)
+    Cents cents[Size];                  // The same prizes in cents, for everything that is paid or summed
+    Cents prefixSum[Size + 1];          // prefixSum[i] = cents[0] + ... + cents[i - 1]
+    Cents total;
+    int lowCount;                       // value[0, lowCount) are "low" prizes
+    Mask allMask;
+    Mask lowMask;
+
+    // Sum of the prizes whose indices are set in `mask`
+    Cents sumOf(Mask mask) const {
+        Cents sum = 0;
+        for (int i = 0; i < Size; i++) {
+            if ((mask >> i) & 1u) sum += cents[i];
+        }
+        return sum;
+    }
+
+    // Index of the prize worth `amount` (to the cent), or -1
+    int indexOf(double amount) const {
+        int low = 0;
+        int high = Size - 1;
+        while (low <= high) {
+            int middle = (low + high) / 2;
+            if (value[middle] < amount - 0.005) {
+                low = middle + 1;
+            } else if (value[middle] > amount + 0.005) {
+                high = middle - 1;
+            } else {
+                return middle;
+            }
+        }
+        return -1;
+    }
+};
+
+template <int N>
+constexpr BasicPrizeBoard<N> makePrizeBoard(const double (&prizes)[N]) {
+    using Mask = CaseMask<N>;
+    BasicPrizeBoard<N> board{};
+    for (int i = 0; i < N; i++) board.value[i] = prizes[i];
+
+    // Insertion sort: the board is ascending whatever the source order
+    for (int i = 1; i < N; i++) {
+        double current = board.value[i];
+        int j = i - 1;
+        while (j >= 0 && board.value[j] > current) {
+            board.value[j + 1] = board.value[j];
+            j--;
+        }
+        board.value[j + 1] = current;
+    }
+
+    board.prefixSum[0] = 0;
+    for (int i = 0; i < N; i++) {
+        // Prizes are whole cents; the dollar value is snapped to match
+        board.cents[i] = toCents(board.value[i]);
+        board.value[i] = toDollars(board.cents[i]);
+        board.prefixSum[i + 1] = board.prefixSum[i] + board.cents[i];
+        if (board.value[i] <= BasicPrizeBoard<N>::LowPrizeLimit) board.lowCount = i + 1;
+    }
+    board.total = board.prefixSum[N];
+    board.allMask = static_cast<Mask>((1ULL << N) - 1);
+    board.lowMask = static_cast<Mask>((1ULL << board.lowCount) - 1);
+    return board;
+}
+
+using PrizeBoard = BasicPrizeBoard<StandardVariant::Cases>;
+
+#endif // DEALMASTER_PRIZE_BOARD_H
@@ -0,0 +1,103 @@
+#ifndef DEALMASTER_PRIZE_RANKS_H
+#define DEALMASTER_PRIZE_RANKS_H
+
+#include <algorithm>
+
+#include "bit_ops.h"
+#include "game_variants.h"
+#include "money.h"
+#include "prize_board.h"
+
+// Order statistics of the prizes still in play. The board is sorted, so a
+// prize's index is its rank and the set in play is a bit mask over ranks:
+// counting the prizes above an amount is a binary search on the board and
+// a popcount, the k-th largest a binary search over popcounts, and opening
+// a case clears one bit. The sum is kept alongside for the mean.
+template <int N>
+class BasicPrizeRanks {
+public:
+    using Mask = CaseMask<N>;
+    using Board = BasicPrizeBoard<N>;
+
+private:
+    const Board* board;
+    Mask mask;
+    Cents sum;
+    int size;
+
+    // Prizes in play with rank `from` or above
+    int countFrom(int from) const {
+        return from >= N ? 0 : popcount32(static_cast<unsigned>(mask) >> from);
+    }
+
+public:
+    explicit BasicPrizeRanks(const Board& prizes, Mask inPlay = 0) : board(&prizes) {
+        reset(inPlay);
+    }
+
+    void reset(Mask inPlay) {
+        mask = inPlay;
+        sum = board->sumOf(inPlay);
+        size = popcount32(inPlay);
+    }
+
+    // The case holding board prize `index` was opened
+    void open(int index) {
+        mask = static_cast<Mask>(mask & ~(1u << index));
+        sum -= board->cents[index];
+        size--;
+    }
+
+    Mask inPlay() const {
+        return mask;
+    }
+
+    int count() const {
+        return size;
+    }
+
+    Cents total() const {
+        return sum;
+    }
+
+    double mean() const {
+        return size > 0 ? toDollars(sum) / size : 0.0;
+    }
+
+    // Prizes in play worth more than `amount`
+    int countAbove(double amount) const {
+        return countFrom(static_cast<int>(std::upper_bound(board->value, board->value + N, amount) - board->value));
+    }
+
+    // Board index of the k-th largest prize in play, 1 <= k <= count()
+    int largest(int k) const {
+        int low = 0;
+        int high = N - 1;
+        while (low < high) {
+            int middle = (low + high + 1) / 2;
+            if (countFrom(middle) >= k) {
+                low = middle;
+            } else {
+                high = middle - 1;
+            }
+        }
+        return low;
+    }
+
+    // The middle prize, or the mean of the middle two
+    double median() const {
+        if (size == 0) return 0.0;
+        Cents middle = board->cents[largest((size + 1) / 2)] + board->cents[largest(size / 2 + 1)];
+        return toDollars(middle) / 2;
+    }
+
+    // Call f(value) for every prize in play, largest first
+    template <class Visit>
+    void forEach(const Visit& visit) const {
+        for (int i = N - 1; i >= 0; i--) {
+            if ((mask >> i) & 1u) visit(board->value[i]);
+        }
+    }
+};
+
+#endif // DEALMASTER_PRIZE_RANKS_H
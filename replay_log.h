@@ -0,0 +1,537 @@
+#ifndef DEALMASTER_REPLAY_LOG_H
+#define DEALMASTER_REPLAY_LOG_H
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "money.h"
+
+// Deterministic replay log.
+//
+// Every game is recorded as a compact event stream: the shuffle seed, the
+// player's case, the cases opened each round in order, and the bank offers
+// with the final decision. Because the prize layout is derived from the
+// seed with a portable shuffle, a record is enough to reconstruct the whole
+// game and to seek to any round without replaying the front-end.
+//
+// Record layout (bit-packed, LSB first):
+//   varint  seed
+//   1 bit   mode (0 = human, 1 = computer)
+//   5 bits  player case
+//   4 bits  number of rounds in which cases were opened
+//   per round: 3 bits count, then 5 bits per opened case
+//   4 bits  number of bank offers
+//   per offer: varint offer in cents
+//   1 bit   last offer accepted (deal)
+//
+// Varints are 7-bit groups with a continuation bit, at most ten of them.
+// A log file is the magic "DMRL", a version byte, then records each
+// prefixed with a byte varint holding the record length. Its sidecar index
+// ("<log>.idx") is the magic "DMRI", a version byte, then the file offset
+// of every record as 8 little-endian bytes, so one record loads without
+// reading the rest of the log. The writer keeps the index in step with the
+// log and readers catch it up with records appended by anything else.
+
+namespace replay {
+
+constexpr int MaxCases = 26;
+constexpr int MaxRounds = 15;
+constexpr std::size_t MaxRecordBytes = 192;
+constexpr char FileMagic[4] = {'D', 'M', 'R', 'L'};
+constexpr std::uint8_t FileVersion = 1;
+
+enum class PlayMode : std::uint8_t {
+    Human = 0,
+    Computer = 1
+};
+
+// Decoded form of one game. Fixed size, so recording never allocates.
+struct GameLog {
+    std::uint64_t seed = 0;
+    PlayMode mode = PlayMode::Human;
+    std::uint8_t playerCase = 0;
+    std::uint8_t roundCount = 0;
+    std::uint8_t offerCount = 0;
+    std::uint8_t openedTotal = 0;
+    bool dealt = false;
+    std::uint8_t openedPerRound[MaxRounds] = {};
+    std::uint8_t opened[MaxCases] = {};     // Case indices in opening order
+    std::int64_t offerCents[MaxRounds] = {};
+
+    void begin(std::uint64_t gameSeed, PlayMode playMode, int caseIndex) {
+        *this = GameLog();
+        seed = gameSeed;
+        mode = playMode;
+        playerCase = static_cast<std::uint8_t>(caseIndex);
+    }
+
+    void beginRound() {
+        if (roundCount < MaxRounds) roundCount++;
+    }
+
+    void openCase(int caseIndex) {
+        if (roundCount == 0 || openedTotal >= MaxCases) return;
+        opened[openedTotal++] = static_cast<std::uint8_t>(caseIndex);
+        openedPerRound[roundCount - 1]++;
+    }
+
+    void offer(Cents amount, bool accepted) {
+        if (offerCount >= MaxRounds) return;
+        offerCents[offerCount++] = amount > 0 ? amount : 0;
+        dealt = accepted;
+    }
+};
+
+// SplitMix64: tiny, fast and fully specified, so a seed produces the same
+// prize layout on every platform and standard library (std::shuffle and
+// the std distributions do not guarantee that)
+inline std::uint64_t splitMix64(std::uint64_t& state) {
+    std::uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Portable Fisher-Yates shuffle driven by SplitMix64
+template <typename T>
+void shuffleWithSeed(std::uint64_t seed, T* values, int count) {
+    std::uint64_t state = seed;
+    for (int i = count - 1; i > 0; i--) {
+        std::uint64_t bound = static_cast<std::uint64_t>(i) + 1;
+        std::uint64_t limit = UINT64_MAX - UINT64_MAX % bound;
+        std::uint64_t draw;
+        do {
+            draw = splitMix64(state);
+        } while (draw >= limit);
+        std::swap(values[i], values[draw % bound]);
+    }
+}
+
+class BitWriter {
+private:
+    std::uint8_t* data;
+    std::size_t capacity;
+    std::size_t bitPos;
+
+public:
+    BitWriter(std::uint8_t* buffer, std::size_t bytes) : data(buffer), capacity(bytes), bitPos(0) {
+        std::memset(data, 0, capacity);
+    }
+
+    void write(std::uint64_t value, int bits) {
+        for (int i = 0; i < bits; i++) {
+            if (bitPos >= capacity * 8) return;
+            if ((value >> i) & 1) data[bitPos >> 3] |= static_cast<std::uint8_t>(1u << (bitPos & 7));
+            bitPos++;
+        }
+    }
+
+    void writeVarint(std::uint64_t value) {
+        do {
+            std::uint64_t group = value & 0x7F;
+            value >>= 7;
+            write(group | (value ? 0x80 : 0), 8);
+        } while (value);
+    }
+
+    std::size_t bytes() const {
+        return (bitPos + 7) / 8;
+    }
+};
+
+class BitReader {
+private:
+    const std::uint8_t* data;
+    std::size_t size;
+    std::size_t bitPos;
+    bool overrun;
+
+public:
+    BitReader(const std::uint8_t* buffer, std::size_t bytes)
+        : data(buffer), size(bytes), bitPos(0), overrun(false) {}
+
+    std::uint64_t read(int bits) {
+        std::uint64_t value = 0;
+        for (int i = 0; i < bits; i++) {
+            if (bitPos >= size * 8) {
+                overrun = true;
+                return value;
+            }
+            value |= static_cast<std::uint64_t>((data[bitPos >> 3] >> (bitPos & 7)) & 1) << i;
+            bitPos++;
+        }
+        return value;
+    }
+
+    std::uint64_t readVarint() {
+        std::uint64_t value = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            std::uint64_t group = read(8);
+            value |= (group & 0x7F) << shift;
+            if (!(group & 0x80) || overrun) return value;
+        }
+        overrun = true; // More than ten groups
+        return value;
+    }
+
+    bool failed() const {
+        return overrun;
+    }
+};
+
+// Encode a game into `buffer`; returns the number of bytes used
+inline std::size_t encodeGame(const GameLog& log, std::uint8_t* buffer, std::size_t capacity) {
+    BitWriter bits(buffer, capacity);
+    bits.writeVarint(log.seed);
+    bits.write(static_cast<std::uint64_t>(log.mode), 1);
+    bits.write(log.playerCase, 5);
+    bits.write(log.roundCount, 4);
+
+    int index = 0;
+    for (int r = 0; r < log.roundCount; r++) {
+        bits.write(log.openedPerRound[r], 3);
+        for (int i = 0; i < log.openedPerRound[r]; i++) {
+            bits.write(log.opened[index++], 5);
+        }
+    }
+
+    bits.write(log.offerCount, 4);
+    for (int i = 0; i < log.offerCount; i++) {
+        bits.writeVarint(static_cast<std::uint64_t>(log.offerCents[i]));
+    }
+    bits.write(log.dealt ? 1 : 0, 1);
+    return bits.bytes();
+}
+
+// Decode one record; returns false if the record is truncated or corrupt
+inline bool decodeGame(const std::uint8_t* buffer, std::size_t size, GameLog& log) {
+    BitReader bits(buffer, size);
+    log = GameLog();
+    log.seed = bits.readVarint();
+    log.mode = static_cast<PlayMode>(bits.read(1));
+    log.playerCase = static_cast<std::uint8_t>(bits.read(5));
+    log.roundCount = static_cast<std::uint8_t>(bits.read(4));
+    if (log.playerCase >= MaxCases || log.roundCount > MaxRounds) return false;
+
+    for (int r = 0; r < log.roundCount; r++) {
+        int count = static_cast<int>(bits.read(3));
+        if (log.openedTotal + count > MaxCases) return false;
+        log.openedPerRound[r] = static_cast<std::uint8_t>(count);
+        for (int i = 0; i < count; i++) {
+            std::uint8_t caseIndex = static_cast<std::uint8_t>(bits.read(5));
+            if (caseIndex >= MaxCases) return false;
+            log.opened[log.openedTotal++] = caseIndex;
+        }
+    }
+
+    log.offerCount = static_cast<std::uint8_t>(bits.read(4));
+    if (log.offerCount > MaxRounds) return false;
+    for (int i = 0; i < log.offerCount; i++) {
+        log.offerCents[i] = static_cast<std::int64_t>(bits.readVarint());
+    }
+    log.dealt = bits.read(1) != 0;
+    return !bits.failed();
+}
+
+// Board state after a given number of rounds
+struct ReplayPosition {
+    int round = 0;                   // Rounds played so far
+    std::uint32_t openedMask = 0;    // Bit i set when case i is open
+    int remainingCount = 0;          // Unopened cases, including the player's
+    Cents remainingSum = 0;
+    bool hasOffer = false;           // An offer was made at the end of `round`
+    Cents offer = 0;
+    bool finished = false;           // Game over at this point
+    bool dealt = false;
+    Cents winnings = 0;
+    Cents caseValues[MaxCases] = {};
+};
+
+// Reconstruct the board after `round` rounds (clamped to the game length).
+// Walks the event stream once: O(events), no rendering.
+inline ReplayPosition seekRound(const GameLog& log, const Cents* prizes, int caseCount, int round) {
+    ReplayPosition pos;
+    for (int i = 0; i < caseCount; i++) pos.caseValues[i] = prizes[i];
+    shuffleWithSeed(log.seed, pos.caseValues, caseCount);
+
+    pos.remainingCount = caseCount;
+    for (int i = 0; i < caseCount; i++) pos.remainingSum += pos.caseValues[i];
+
+    if (round > log.roundCount) round = log.roundCount;
+    int index = 0;
+    for (int r = 0; r < round; r++) {
+        for (int i = 0; i < log.openedPerRound[r]; i++) {
+            int caseIndex = log.opened[index++];
+            pos.openedMask |= 1u << caseIndex;
+            pos.remainingCount--;
+            pos.remainingSum -= pos.caseValues[caseIndex];
+        }
+    }
+    pos.round = round;
+
+    if (round > 0 && round <= log.offerCount) {
+        pos.hasOffer = true;
+        pos.offer = log.offerCents[round - 1];
+    }
+
+    pos.finished = round == log.roundCount;
+    if (pos.finished) {
+        pos.dealt = log.dealt;
+        pos.winnings = log.dealt && log.offerCount > 0
+            ? log.offerCents[log.offerCount - 1]
+            : pos.caseValues[log.playerCase];
+    }
+    return pos;
+}
+
+constexpr std::size_t HeaderBytes = sizeof(FileMagic) + 1;
+constexpr std::size_t MaxPrefixBytes = 10;
+constexpr char IndexMagic[4] = {'D', 'M', 'R', 'I'};
+constexpr std::uint8_t IndexVersion = 1;
+
+// The sidecar index of the log at `path`
+inline std::string indexPath(const std::string& path) {
+    return path + ".idx";
+}
+
+inline std::uint64_t fileSize(std::istream& file) {
+    file.clear();
+    file.seekg(0, std::ios::end);
+    std::streamoff size = file.tellg();
+    return size > 0 ? static_cast<std::uint64_t>(size) : 0;
+}
+
+// True if `file` starts with `magic` and `version`
+inline bool readHeader(std::istream& file, const char (&magic)[4], std::uint8_t version) {
+    char header[HeaderBytes];
+    file.clear();
+    file.seekg(0);
+    file.read(header, sizeof(header));
+    return file.gcount() == static_cast<std::streamsize>(sizeof(header)) &&
+           std::memcmp(header, magic, sizeof(magic)) == 0 && static_cast<std::uint8_t>(header[4]) == version;
+}
+
+inline void writeOffset(std::ostream& file, std::uint64_t offset) {
+    char bytes[8];
+    for (int i = 0; i < 8; i++) bytes[i] = static_cast<char>((offset >> (i * 8)) & 0xFF);
+    file.write(bytes, sizeof(bytes));
+}
+
+// Offset of the `entry`-th record from the index; false past its end
+inline bool readOffset(std::istream& index, std::uint64_t entry, std::uint64_t& offset) {
+    unsigned char bytes[8];
+    index.clear();
+    index.seekg(static_cast<std::streamoff>(HeaderBytes + entry * 8));
+    index.read(reinterpret_cast<char*>(bytes), sizeof(bytes));
+    if (index.gcount() != static_cast<std::streamsize>(sizeof(bytes))) return false;
+    offset = 0;
+    for (int i = 0; i < 8; i++) offset |= static_cast<std::uint64_t>(bytes[i]) << (i * 8);
+    return true;
+}
+
+// Parse the length prefix at the front of `buffer`; returns the prefix
+// size, or 0 if it runs past `size` or past ten bytes, or if the length
+// is more than any record can take
+inline std::size_t parseLength(const std::uint8_t* buffer, std::size_t size, std::size_t& length) {
+    length = 0;
+    for (std::size_t i = 0; i < size && i < MaxPrefixBytes; i++) {
+        length |= static_cast<std::size_t>(buffer[i] & 0x7F) << (i * 7);
+        if (!(buffer[i] & 0x80)) return length <= MaxRecordBytes ? i + 1 : 0;
+    }
+    return 0;
+}
+
+// Read the record at `offset` of `log` into `buffer` (at least
+// MaxPrefixBytes + MaxRecordBytes long); `start` and `length` locate the
+// record inside it. False if the record is cut short or malformed.
+inline bool readRecord(std::istream& log, std::uint64_t offset, std::uint8_t* buffer,
+                       std::size_t& start, std::size_t& length) {
+    log.clear();
+    log.seekg(static_cast<std::streamoff>(offset));
+    log.read(reinterpret_cast<char*>(buffer), static_cast<std::streamsize>(MaxPrefixBytes + MaxRecordBytes));
+    std::size_t got = static_cast<std::size_t>(log.gcount());
+    start = parseLength(buffer, got, length);
+    return start != 0 && length <= got - start;
+}
+
+// Call `found(offset)` for every whole record from `offset` to `end` in
+// order, stopping at a truncated or malformed tail
+template <class Found>
+void scanRecords(std::istream& log, std::uint64_t offset, std::uint64_t end, Found found) {
+    log.clear();
+    log.seekg(static_cast<std::streamoff>(offset));
+    while (offset < end) {
+        std::uint8_t prefix[MaxPrefixBytes];
+        std::size_t prefixSize = 0;
+        while (prefixSize < MaxPrefixBytes && offset + prefixSize < end) {
+            int byte = log.get();
+            if (byte == std::char_traits<char>::eof()) return;
+            prefix[prefixSize++] = static_cast<std::uint8_t>(byte);
+            if (!(byte & 0x80)) break;
+        }
+        std::size_t length;
+        std::size_t used = parseLength(prefix, prefixSize, length);
+        if (used == 0 || length > end - offset - used) return;
+        found(offset);
+        log.ignore(static_cast<std::streamsize>(length));
+        offset += used + length;
+    }
+}
+
+// Bring the sidecar index of the log at `path` up to date. Only the records
+// after the last indexed one are scanned; an index that is missing, damaged
+// or whose last record does not end inside the log is rebuilt. False if
+// `path` is not a replay log or the index cannot be written.
+inline bool updateIndex(const std::string& path) {
+    std::ifstream log(path, std::ios::binary);
+    if (!log.is_open() || !readHeader(log, FileMagic, FileVersion)) return false;
+    std::uint64_t logSize = fileSize(log);
+
+    std::uint64_t covered = HeaderBytes;
+    bool rebuild = true;
+    {
+        std::ifstream index(indexPath(path), std::ios::binary);
+        if (index.is_open() && readHeader(index, IndexMagic, IndexVersion)) {
+            std::uint64_t indexSize = fileSize(index);
+            if ((indexSize - HeaderBytes) % 8 == 0) {
+                std::uint64_t entries = (indexSize - HeaderBytes) / 8;
+                std::uint64_t last;
+                std::uint8_t buffer[MaxPrefixBytes + MaxRecordBytes];
+                std::size_t start, length;
+                if (entries == 0) {
+                    rebuild = false;
+                } else if (readOffset(index, entries - 1, last) && last >= HeaderBytes && last < logSize &&
+                           readRecord(log, last, buffer, start, length)) {
+                    covered = last + start + length;
+                    rebuild = false;
+                }
+            }
+        }
+    }
+    if (!rebuild && covered == logSize) return true;
+
+    std::ofstream index(indexPath(path), std::ios::binary | (rebuild ? std::ios::trunc : std::ios::app));
+    if (!index.is_open()) return false;
+    if (rebuild) {
+        index.write(IndexMagic, sizeof(IndexMagic));
+        index.put(static_cast<char>(IndexVersion));
+    }
+    scanRecords(log, covered, logSize, [&](std::uint64_t offset) { writeOffset(index, offset); });
+    index.flush();
+    return static_cast<bool>(index);
+}
+
+// Appends encoded games to a log file and their offsets to its index
+class ReplayWriter {
+private:
+    std::ofstream file;
+    std::ofstream index;
+    std::uint64_t position;
+
+public:
+    explicit ReplayWriter(const std::string& path) : position(0) {
+        {
+            std::ifstream existing(path, std::ios::binary);
+            if (existing.is_open()) position = fileSize(existing);
+        }
+        file.open(path, std::ios::binary | std::ios::app);
+        if (!file.is_open()) return;
+        if (position == 0) {
+            file.write(FileMagic, sizeof(FileMagic));
+            file.put(static_cast<char>(FileVersion));
+            file.flush();
+            position = HeaderBytes;
+        }
+        // Without an up-to-date index the next reader scans the new records
+        if (updateIndex(path)) index.open(indexPath(path), std::ios::binary | std::ios::app);
+    }
+
+    bool isOpen() const {
+        return file.is_open();
+    }
+
+    void append(const GameLog& log) {
+        std::uint8_t record[MaxRecordBytes];
+        std::size_t size = encodeGame(log, record, sizeof(record));
+
+        std::uint8_t prefix[MaxPrefixBytes];
+        std::size_t prefixSize = 0;
+        std::size_t length = size;
+        do {
+            prefix[prefixSize] = static_cast<std::uint8_t>(length & 0x7F);
+            length >>= 7;
+            if (length) prefix[prefixSize] |= 0x80;
+            prefixSize++;
+        } while (length);
+
+        file.write(reinterpret_cast<const char*>(prefix), static_cast<std::streamsize>(prefixSize));
+        file.write(reinterpret_cast<const char*>(record), static_cast<std::streamsize>(size));
+        if (index.is_open()) writeOffset(index, position);
+        position += prefixSize + size;
+    }
+
+    // The log goes first; an index flushed ahead of it is rebuilt on open
+    void flush() {
+        file.flush();
+        index.flush();
+    }
+};
+
+// Reads single records of a log through its index: a load is two seeks
+// and one short read, whatever the size of the log
+class ReplayReader {
+private:
+    mutable std::ifstream logFile;
+    mutable std::ifstream indexFile;
+    std::uint64_t count = 0;
+    std::vector<std::uint64_t> offsets; // Only when the index cannot be written
+
+public:
+    // Returns false if the file is missing or not a replay log
+    bool open(const std::string& path) {
+        logFile.close();
+        indexFile.close();
+        count = 0;
+        offsets.clear();
+
+        logFile.open(path, std::ios::binary);
+        if (!logFile.is_open() || !readHeader(logFile, FileMagic, FileVersion)) return false;
+
+        if (updateIndex(path)) {
+            indexFile.open(indexPath(path), std::ios::binary);
+            if (indexFile.is_open() && readHeader(indexFile, IndexMagic, IndexVersion)) {
+                count = (fileSize(indexFile) - HeaderBytes) / 8;
+                return true;
+            }
+            indexFile.close();
+        }
+        scanRecords(logFile, HeaderBytes, fileSize(logFile), [&](std::uint64_t offset) { offsets.push_back(offset); });
+        count = offsets.size();
+        return true;
+    }
+
+    std::size_t size() const {
+        return static_cast<std::size_t>(count);
+    }
+
+    bool load(std::size_t index, GameLog& game) const {
+        if (index >= count) return false;
+        std::uint64_t offset;
+        if (offsets.empty()) {
+            if (!readOffset(indexFile, index, offset)) return false;
+        } else {
+            offset = offsets[index];
+        }
+        std::uint8_t buffer[MaxPrefixBytes + MaxRecordBytes];
+        std::size_t start, length;
+        return readRecord(logFile, offset, buffer, start, length) && decodeGame(buffer + start, length, game);
+    }
+};
+
+} // namespace replay
+
+#endif // DEALMASTER_REPLAY_LOG_H
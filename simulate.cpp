@@ -0,0 +1,142 @@
+// Standalone simulator: the --simulate mode of dealmaster without the
+// interactive game, replay tools or server. It is also the training
+// workload of the profile-guided build (see CMakeLists.txt).
+//
+// Build: g++ -std=c++17 -O2 -Wall -o dealmaster-sim simulate.cpp alloc_hooks.cpp
+#include <algorithm>
+#include <cstdint>
+#include <iostream>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "bank_model.h"
+#include "input_parser.h"
+#include "metrics.h"
+#include "simulator.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+static void printUsage(const char* program) {
+    std::cout << "Usage: " << program << " [--games N] [--seed S] [--variant NAME | --variant-file F] [--bank MODEL]\n"
+              << "       [--threads N] [--swap-policy P] [--archive OUT] [--metrics FILE] [--trace FILE]\n"
+              << "  --games N      computer games to play (default 1000000)\n"
+              << "  --seed S       seed of the first game; game i is dealt from S + i (default 1)\n"
+              << "  --variant NAME board and schedule:";
+    forEachVariant([](auto variant) { std::cout << ' ' << decltype(variant)::Name; });
+    std::cout << " (default " << StandardVariant::Name << ")\n"
+              << "  --variant-file F  load prizes, round schedule and offer curve from variant file F\n"
+              << "  --bank MODEL   how the bank prices offers:";
+    for (std::string_view name : BankModelNames) std::cout << ' ' << name;
+    std::cout << " (default mean)\n"
+              << "  --threads N    worker threads (default all cores)\n"
+              << "  --swap-policy P  final swap in swap variants: keep, swap or computer\n"
+              << "  --archive OUT  also write every game to OUT as a 32-byte compact record\n"
+              << "  --metrics FILE Prometheus metrics, rewritten every 5 s\n"
+              << "  --trace FILE   Chrome trace of the batches\n";
+}
+
+int main(int argc, char* argv[]) {
+    long long games = 1000000;
+    std::uint64_t seed = 1;
+    std::string variantName(StandardVariant::Name);
+    std::string variantFile;
+    std::string bankName("mean");
+    int threads = std::max(1, static_cast<int>(std::thread::hardware_concurrency()));
+    SwapPolicy swapPolicy = SwapPolicy::Computer;
+    std::string archivePath;
+    std::string metricsPath;
+    std::string tracePath;
+
+    for (int i = 1; i < argc; i++) {
+        std::string_view arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--games" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            games = value.value;
+        } else if (arg == "--seed" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 0, std::numeric_limits<int>::max());
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            seed = static_cast<std::uint64_t>(value.value);
+        } else if (arg == "--variant" && hasValue) {
+            variantName = argv[++i];
+        } else if (arg == "--variant-file" && hasValue) {
+            variantFile = argv[++i];
+        } else if (arg == "--bank" && hasValue) {
+            bankName = argv[++i];
+            if (std::find(std::begin(BankModelNames), std::end(BankModelNames), bankName) == std::end(BankModelNames)) {
+                std::cout << "Unknown bank model: " << bankName << std::endl;
+                printUsage(argv[0]);
+                return 1;
+            }
+        } else if (arg == "--threads" && hasValue) {
+            ParseResult value = parseInt(argv[++i], 1, 1024);
+            if (!value.ok()) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            threads = value.value;
+        } else if (arg == "--swap-policy" && hasValue) {
+            std::string_view name = argv[++i];
+            auto found = std::find(std::begin(SwapPolicyNames), std::end(SwapPolicyNames), name);
+            if (found == std::end(SwapPolicyNames)) {
+                printUsage(argv[0]);
+                return 1;
+            }
+            swapPolicy = static_cast<SwapPolicy>(found - std::begin(SwapPolicyNames));
+        } else if (arg == "--archive" && hasValue) {
+            archivePath = argv[++i];
+        } else if (arg == "--metrics" && hasValue) {
+            metricsPath = argv[++i];
+        } else if (arg == "--trace" && hasValue) {
+            tracePath = argv[++i];
+        } else {
+            printUsage(argv[0]);
+            return arg == "--help" ? 0 : 1;
+        }
+    }
+
+    trace::TraceWriter tracer;
+    if (!tracePath.empty() && !tracer.open(tracePath)) {
+        std::cerr << "Cannot open trace file: " << tracePath << std::endl;
+        return 1;
+    }
+    metrics::MetricsWriter metricsFile;
+    if (!metricsPath.empty() && !metricsFile.open(metricsPath)) {
+        std::cerr << "Cannot write metrics file: " << metricsPath << std::endl;
+        return 1;
+    }
+
+    int status = 0;
+    auto simulate = [&](auto variant, const auto& rules) {
+        using Variant = decltype(variant);
+        SimulationRunner simulation;
+        status = simulation.run<Variant>(rules, *findBankModel<Variant::Cases>(bankName), games, seed, swapPolicy,
+                                         threads, archivePath);
+    };
+
+    if (!variantFile.empty()) {
+        VariantSpec spec;
+        std::string error;
+        if (!loadVariantFile(variantFile, spec, error)) {
+            std::cerr << "Invalid variant file: " << error << std::endl;
+            return 1;
+        }
+        withLoadedRules(spec, simulate);
+        return status;
+    }
+    if (!withBuiltinRules(variantName, simulate)) {
+        std::cout << "Unknown variant: " << variantName << std::endl;
+        printUsage(argv[0]);
+        return 1;
+    }
+    return status;
+}
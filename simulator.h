@@ -0,0 +1,276 @@
+#ifndef DEALMASTER_SIMULATOR_H
+#define DEALMASTER_SIMULATOR_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "bank_model.h"
+#include "compact_record.h"
+#include "computer_player.h"
+#include "frame_buffer.h"
+#include "game_variants.h"
+#include "metrics.h"
+#include "money.h"
+#include "prize_ranks.h"
+#include "replay_log.h"
+#include "trace_events.h"
+#include "variant_rules.h"
+
+// What the simulated player does at the final swap (variants with a swap)
+enum class SwapPolicy : std::uint8_t {
+    Keep,
+    Swap,
+    Computer        // ComputerPlayer::shouldSwap
+};
+
+inline constexpr std::string_view SwapPolicyNames[] = {"keep", "swap", "computer"};
+
+// Totals of a simulation run
+struct SimulationResult {
+    long long games = 0;
+    long long deals = 0;
+    long long swaps = 0;
+    CentsTotal totalPayout;         // Exact, so batch totals merge to the same sum in any split
+    long long reachedRound[MaxScheduleRounds] = {};    // Games that were made the offer of round r + 1
+    long long dealsInRound[MaxScheduleRounds] = {};
+
+    double meanPayout() const {
+        return games > 0 ? totalPayout.dollars() / games : 0.0;
+    }
+
+    void merge(const SimulationResult& other) {
+        games += other.games;
+        deals += other.deals;
+        swaps += other.swaps;
+        totalPayout.merge(other.totalPayout);
+        for (int r = 0; r < MaxScheduleRounds; r++) {
+            reachedRound[r] += other.reachedRound[r];
+            dealsInRound[r] += other.dealsInRound[r];
+        }
+    }
+};
+
+// Self-play of the computer player with no console, stats file or replay
+// log. Offers come from a baked OfferTable, so the bank costs one lookup
+// per round whatever model it was baked from.
+//
+// Game i is dealt with the portable shuffle from seed + i; the shuffled
+// order doubles as the play order (the first case is the player's, the
+// rest are opened front to back), which is the same distribution as a
+// random pick followed by random openings. Case c always holds prize c,
+// which is how archived games record the board.
+template <class Variant>
+class Simulator {
+public:
+    static constexpr int Cases = Variant::Cases;
+    using Rules = BasicGameRules<Cases>;
+    using OfferTable = BasicOfferTable<Cases>;
+    using Mask = CaseMask<Cases>;
+
+private:
+    const Rules& rules;
+    const OfferTable& offers;
+    const ComputerPlayer& player;
+    SwapPolicy swapPolicy;
+
+    // With metrics on, one game in DecisionSample has its decisions timed
+    static constexpr long long DecisionSample = 64;
+
+    // Pack a finished game for an archive
+    static void archive(const std::uint8_t* order, int opened, int played, bool dealt, const Rules& rules,
+                        compact::GameRecord& record) {
+        compact::GameLayout game;
+        for (int c = 0; c < compact::Cases; c++) game.casePrize[c] = static_cast<std::uint8_t>(c);
+        game.playerCase = order[0];
+        for (int i = 0; i < compact::Cases; i++) game.openOrder[i] = i < opened ? order[i + 1] : 0;
+        game.openedCount = static_cast<std::uint8_t>(opened);
+        game.roundCount = static_cast<std::uint8_t>(played);
+        for (int r = 0; r < compact::Rounds; r++) {
+            game.openedPerRound[r] = static_cast<std::uint8_t>(r < played ? rules.casesPerRound[r] : 0);
+        }
+        game.dealRound = static_cast<std::uint8_t>(dealt ? played : 0);
+        compact::encode(game, record);
+    }
+
+public:
+    // True if games of `rules` fit the 32-byte archive records
+    static bool archivable(const Rules& rules) {
+        if (Cases != compact::Cases || rules.rounds > compact::Rounds) return false;
+        for (int r = 0; r < rules.rounds; r++) {
+            if (rules.casesPerRound[r] > 7) return false;
+        }
+        return true;
+    }
+
+    Simulator(const Rules& gameRules, const OfferTable& offerTable, SwapPolicy swapping = SwapPolicy::Computer)
+        : rules(gameRules), offers(offerTable), player(ComputerPlayer::shared()), swapPolicy(swapping) {}
+
+    // Play `games` games starting at `seed` and add them to `result`; with
+    // `records` (and archivable rules), game i is also packed into records[i]
+    void run(long long games, std::uint64_t seed, SimulationResult& result, compact::GameRecord* records = nullptr) {
+        std::uint8_t order[Cases];
+        metrics::ThreadMetrics* timings = metrics::enabled() ? &metrics::local() : nullptr;
+        for (long long game = 0; game < games; game++) {
+            bool timed = timings && game % DecisionSample == 0;
+            for (int i = 0; i < Cases; i++) order[i] = static_cast<std::uint8_t>(i);
+            replay::shuffleWithSeed(seed + static_cast<std::uint64_t>(game), order, Cases);
+
+            BasicPrizeRanks<Cases> remaining(rules.board, rules.board.allMask);
+            int next = 1;
+            Cents payout = rules.board.cents[order[0]];
+            bool dealt = false;
+            int played = 0;
+            for (int r = 0; r < rules.rounds; r++) {
+                played++;
+                for (int i = 0; i < rules.casesPerRound[r]; i++) {
+                    remaining.open(order[next++]);
+                }
+                Cents offer = offers.offer(r + 1, remaining.inPlay());
+                result.reachedRound[r]++;
+
+                std::uint64_t started = timed ? metrics::now() : 0;
+                bool accept = player.shouldAcceptDeal(remaining, toDollars(offer), remaining.count());
+                if (timed) metrics::recordLatency(*timings, metrics::Histogram::Decision, metrics::now() - started);
+                if (accept) {
+                    payout = offer;
+                    dealt = true;
+                    result.deals++;
+                    result.dealsInRound[r]++;
+                    break;
+                }
+            }
+
+            // The last case left in the shuffled order is the one on offer
+            if (!dealt && rules.finalSwap) {
+                bool swap = swapPolicy == SwapPolicy::Swap
+                         || (swapPolicy == SwapPolicy::Computer && player.shouldSwap(remaining));
+                if (swap) {
+                    payout = rules.board.cents[order[next]];
+                    result.swaps++;
+                }
+            }
+            result.totalPayout.add(payout);
+            result.games++;
+            if constexpr (Cases == compact::Cases) {
+                if (records) archive(order, next - 1, played, dealt, rules, records[game]);
+            }
+        }
+    }
+};
+
+// Simulation mode: the computer player plays many games against a bank
+// model baked into an offer table, and the bank's payout is reported
+class SimulationRunner {
+private:
+    FrameBuffer report;
+
+public:
+    SimulationRunner() : report(1) {}
+
+    // Games per unit of work handed to a thread
+    static constexpr long long BatchGames = 1 << 16;
+
+    // Add a finished batch to the calling thread's metrics
+    static void publish(const SimulationResult& batch) {
+        metrics::ThreadMetrics& block = metrics::local();
+        metrics::bump(block.games, static_cast<std::uint64_t>(batch.games));
+        for (int r = 0; r < MaxScheduleRounds; r++) {
+            metrics::bump(block.offers[r], static_cast<std::uint64_t>(batch.reachedRound[r]));
+            metrics::bump(block.deals[r], static_cast<std::uint64_t>(batch.dealsInRound[r]));
+        }
+    }
+
+    // With `archivePath`, every game is also written there as a 32-byte
+    // compact record, in game order
+    template <class Variant>
+    int run(const BasicGameRules<Variant::Cases>& rules, const BasicBankModel<Variant::Cases>& bank,
+            long long games, std::uint64_t seed, SwapPolicy swapPolicy, int threads,
+            const std::string& archivePath = std::string()) {
+        std::vector<compact::GameRecord> records;
+        if (!archivePath.empty()) {
+            if (!Simulator<Variant>::archivable(rules)) {
+                report.put("Archives hold games of 26 cases in at most 9 rounds of at most 7 cases\n");
+                report.flush();
+                return 1;
+            }
+            records.resize(static_cast<std::size_t>(games));
+        }
+
+        auto started = std::chrono::steady_clock::now();
+        BasicOfferTable<Variant::Cases> offers;
+        offers.bake(bank, rules);
+        double bakeSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        // Threads claim batches in any order but the batch totals are merged
+        // in game order, so the report does not depend on the thread count
+        started = std::chrono::steady_clock::now();
+        long long batches = (games + BatchGames - 1) / BatchGames;
+        threads = static_cast<int>(std::min<long long>(threads, batches));
+        std::vector<SimulationResult> batchResults(static_cast<std::size_t>(batches));
+        std::atomic<long long> nextBatch{0};
+        auto work = [&](int part) {
+            trace::nameThread("simulate " + std::to_string(part));
+            Simulator<Variant> simulator(rules, offers, swapPolicy);
+            for (long long batch; (batch = nextBatch.fetch_add(1, std::memory_order_relaxed)) < batches;) {
+                long long first = batch * BatchGames;
+                long long count = std::min(BatchGames, games - first);
+                trace::Span span("batch", "simulate", "games", count);
+                simulator.run(count, seed + static_cast<std::uint64_t>(first), batchResults[batch],
+                              records.empty() ? nullptr : records.data() + first);
+                if (metrics::enabled()) publish(batchResults[batch]);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int part = 1; part < threads; part++) pool.emplace_back(work, part);
+        work(0);
+        for (std::thread& thread : pool) thread.join();
+
+        SimulationResult result;
+        {
+            trace::Span span("merge", "simulate", "batches", batches);
+            for (const SimulationResult& batch : batchResults) result.merge(batch);
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - started).count();
+
+        report.put("=== SIMULATION ===\n");
+        report.put("Variant: ").put(rules.name).put("  Bank: ").put(bank.name());
+        report.put("  Threads: ").putInt(threads).newline();
+        report.put("Offer table: ").putInt(static_cast<long long>(offers.size())).put(" offers baked in ");
+        report.putFixed(bakeSeconds, 3).put(" s\n");
+        report.put("Games: ").putInt(result.games).put(" in ").putFixed(seconds, 3).put(" s (");
+        report.putFixed(seconds > 0 ? result.games / seconds : 0.0, 0).put(" games/s)\n");
+        report.put("Mean payout: ").putMoney(result.meanPayout()).newline();
+        report.put("Deals: ").putInt(result.deals).put(" (");
+        report.putFixed(result.games > 0 ? 100.0 * result.deals / result.games : 0.0, 1).put("%)\n");
+        if (rules.finalSwap) {
+            report.put("Swaps: ").putInt(result.swaps).put(" (policy ");
+            report.put(SwapPolicyNames[static_cast<int>(swapPolicy)]).put(")\n");
+        }
+        report.newline();
+        for (int r = 0; r < rules.rounds; r++) {
+            report.put("round=").putInt(r + 1).put(" reached=");
+            report.putFixed(result.games > 0 ? 100.0 * result.reachedRound[r] / result.games : 0.0, 1);
+            report.put("% deals=").putInt(result.dealsInRound[r]).newline();
+        }
+        if (!archivePath.empty()) {
+            if (!compact::writeArchive(archivePath, records)) {
+                report.put("Cannot write archive: ").put(archivePath).newline();
+                report.flush();
+                return 1;
+            }
+            report.put("Archived ").putInt(static_cast<long long>(records.size())).put(" games (");
+            report.putInt(static_cast<long long>(records.size() * sizeof(compact::GameRecord))).put(" bytes) to ");
+            report.put(archivePath).newline();
+        }
+        report.flush();
+        return 0;
+    }
+};
+
+#endif // DEALMASTER_SIMULATOR_H
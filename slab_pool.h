@@ -0,0 +1,74 @@
+#ifndef DEALMASTER_SLAB_POOL_H
+#define DEALMASTER_SLAB_POOL_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+// Pool of fixed-size records addressed by 32-bit index.
+//
+// Records are carved from chunks of ChunkSize that are allocated on demand
+// and never move, so references stay valid while a record is live. Freed
+// indices go on a free list and are reused most-recent-first, which keeps
+// recently touched (cache-warm) records in play. Only growing by a chunk
+// allocates; steady-state allocate/release is a vector push or pop.
+template <typename T, std::size_t ChunkSize = 1024>
+class SlabPool {
+    static_assert(std::is_trivially_copyable<T>::value, "SlabPool holds plain records");
+
+private:
+    std::vector<std::unique_ptr<T[]>> chunks;
+    std::vector<std::uint32_t> freeSlots;
+    std::size_t limit;
+    std::size_t live;
+
+public:
+    explicit SlabPool(std::size_t maxRecords) : limit(maxRecords), live(0) {}
+
+    SlabPool(const SlabPool&) = delete;
+    SlabPool& operator=(const SlabPool&) = delete;
+
+    // Take a record; false once `maxRecords` are live
+    bool allocate(std::uint32_t& index) {
+        if (live >= limit) return false;
+        if (freeSlots.empty()) {
+            std::size_t first = chunks.size() * ChunkSize;
+            chunks.emplace_back(new T[ChunkSize]);
+            freeSlots.reserve(first + ChunkSize);
+            for (std::size_t i = first + ChunkSize; i > first; i--) {
+                freeSlots.push_back(static_cast<std::uint32_t>(i - 1));
+            }
+        }
+        index = freeSlots.back();
+        freeSlots.pop_back();
+        live++;
+        return true;
+    }
+
+    void release(std::uint32_t index) {
+        freeSlots.push_back(index);
+        live--;
+    }
+
+    T& operator[](std::uint32_t index) {
+        return chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    const T& operator[](std::uint32_t index) const {
+        return chunks[index / ChunkSize][index % ChunkSize];
+    }
+
+    // Records in use
+    std::size_t size() const {
+        return live;
+    }
+
+    // Records backed by memory, live or free
+    std::size_t reserved() const {
+        return chunks.size() * ChunkSize;
+    }
+};
+
+#endif // DEALMASTER_SLAB_POOL_H
@@ -0,0 +1,500 @@
+// Checks of the core library: input parsing, money arithmetic, the baked
+// offer table, the advisor's text, prize order statistics, lookahead and
+// offer preview, the shared state cache, simulation determinism and the
+// server session protocol.
+// Prints each failed check and exits non-zero if there was one.
+//
+// Build: see CMakeLists.txt (target dealmaster-tests, run by ctest)
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "alloc_hooks.h"
+#include "bank_model.h"
+#include "bit_ops.h"
+#include "computer_player.h"
+#include "game_session.h"
+#include "input_parser.h"
+#include "lookahead.h"
+#include "money.h"
+#include "offer_preview.h"
+#include "position_analyzer.h"
+#include "simulator.h"
+#include "text_writer.h"
+#include "transposition_cache.h"
+#include "variant_rules.h"
+
+namespace {
+
+int failures = 0;
+
+#define CHECK(condition)                                                                      \
+    do {                                                                                      \
+        if (!(condition)) {                                                                   \
+            std::cout << __FILE__ << ':' << __LINE__ << ": check failed: " #condition "\n";  \
+            failures++;                                                                       \
+        }                                                                                     \
+    } while (0)
+
+using Variant = Compact16Variant;
+constexpr int Cases = Variant::Cases;
+const BasicGameRules<Cases>& rules = BuiltinRules<Variant>;
+
+void testParseInt() {
+    CHECK(parseInt(" 7\r\n", 1, 26).ok() && parseInt("7", 1, 26).value == 7);
+    CHECK(parseInt("", 1, 26).error == ParseError::Empty);
+    CHECK(parseInt("7x", 1, 26).error == ParseError::NonNumeric);
+    CHECK(parseInt("27", 1, 26).error == ParseError::OutOfRange);
+    CHECK(parseInt("99999999999", 1, 26).error == ParseError::OutOfRange);
+    CHECK(parseYesNo("Y").ok() && parseYesNo("y").value == 1 && parseYesNo("n").value == 0);
+}
+
+void testMoney() {
+    CHECK(toCents(0.01) == 1 && toCents(1000000.0) == 100000000 && toCents(-2.505) == -251);
+    CHECK(meanCents(10, 4) == 3 && meanCents(7, 2) == 4 && meanCents(-7, 2) == -4);
+    CHECK(scaleCents(123457, 0.15) == 18519);
+
+    Cents amount = 0;
+    CHECK(parseCents("1234.56", amount) && amount == 123456);
+    CHECK(parseCents("-0.01", amount) && amount == -1);
+    CHECK(parseCents("7.5", amount) && amount == 750 && parseCents("12", amount) && amount == 1200);
+    CHECK(!parseCents("1.234", amount) && !parseCents("1.", amount) && !parseCents("", amount));
+    CHECK(!parseCents("12a", amount) && !parseCents("99999999999999999999", amount));
+
+    char text[44];
+    CentsTotal total;
+    CHECK(total.format(text) == "0.00");
+    total.add(5);
+    CHECK(total.format(text) == "0.05");
+    total.add(-1005);
+    CHECK(total.format(text) == "-10.00");
+
+    // Past 64 bits: 2^64 cents and back
+    CentsTotal big;
+    for (int i = 0; i < 4; i++) big.add(INT64_C(0x4000000000000000));
+    CHECK(big.format(text) == "184467440737095516.16");
+    CentsTotal parsed;
+    CHECK(parsed.parse("184467440737095516.16") && parsed == big);
+    big.add(-1);
+    big.add(1);
+    CHECK(parsed == big && big.dollars() == 184467440737095516.16);
+
+    CHECK(parsed.parse("12.5") && parsed.format(text) == "12.50");
+    CHECK(parsed.parse("-0.07") && parsed.format(text) == "-0.07");
+    CHECK(!parsed.parse("1.23457e+06") && !parsed.parse("1.234") && !parsed.parse("") && !parsed.parse("."));
+}
+
+void testOfferTable() {
+    for (std::string_view name : BankModelNames) {
+        const BasicBankModel<Cases>& bank = *findBankModel<Cases>(name);
+        BasicOfferTable<Cases> offers;
+        offers.bake(bank, rules);
+        int mismatches = 0;
+        for (int round = 1; round <= rules.rounds; round++) {
+            std::uint64_t state = static_cast<std::uint64_t>(round);
+            for (int sample = 0; sample < 200; sample++) {
+                std::uint8_t order[Cases];
+                for (int i = 0; i < Cases; i++) order[i] = static_cast<std::uint8_t>(i);
+                replay::shuffleWithSeed(replay::splitMix64(state), order, Cases);
+                CaseMask<Cases> mask = 0;
+                for (int i = 0; i < offers.prizesInPlay(round); i++) {
+                    mask |= static_cast<CaseMask<Cases>>(CaseMask<Cases>(1) << order[i]);
+                }
+                if (offers.offer(round, mask) != bank.offer(rules, round, mask)) mismatches++;
+            }
+        }
+        CHECK(mismatches == 0);
+    }
+}
+
+void testAdvice() {
+    char buffer[512];
+    TextWriter out(buffer, sizeof(buffer));
+    ComputerPlayer::shared().writeAdvice(out, {1.0, 100.0, 1000.0}, 300.0, 3);
+    CHECK(out.view() == "\n=== AI ADVISOR ===\n"
+                        "Expected Value: $367.00\n"
+                        "Median Prize: $100.00\n"
+                        "Bank Offer: $300.00\n"
+                        "Offer vs Expected: 81.7%\n"
+                        "Risk Level: 122.5%\n"
+                        "Prizes Above Offer: 1 of 3\n"
+                        "RECOMMENDATION: DEAL! The offer is favorable.\n");
+
+    TextWriter swap(buffer, sizeof(buffer));
+    ComputerPlayer::shared().writeSwapAdvice(swap, {5.0, 50.0});
+    CHECK(swap.view() == "\n=== AI ADVISOR ===\n"
+                         "Your case holds $5.00: 50.0%\n"
+                         "Your case holds $50.00: 50.0%\n"
+                         "Expected Value (keep or swap): $27.50\n"
+                         "RECOMMENDATION: Either way! Swapping does not change your odds.\n");
+}
+
+// Order statistics kept by bit mask agree with sorting the values, and the
+// advisor says the same from either
+void testPrizeRanks() {
+    BasicPrizeRanks<Cases> ranks(rules.board, rules.board.allMask);
+    std::vector<double> values(rules.board.value, rules.board.value + Cases);
+    for (int opened : {3, 15, 0, 9, 10, 4, 12, 7}) {
+        ranks.open(opened);
+        values.erase(std::find(values.begin(), values.end(), rules.board.value[opened]));
+        std::sort(values.rbegin(), values.rend());
+        int count = static_cast<int>(values.size());
+        CHECK(ranks.count() == count && ranks.total() == rules.board.sumOf(ranks.inPlay()));
+        for (int k = 1; k <= count; k++) CHECK(rules.board.value[ranks.largest(k)] == values[k - 1]);
+        CHECK(ranks.median() == (values[(count - 1) / 2] + values[count / 2]) / 2);
+        for (double amount : {0.0, 5.0, 7.5, 250000.0}) {
+            CHECK(ranks.countAbove(amount) == std::count_if(values.begin(), values.end(), [&](double v) { return v > amount; }));
+        }
+
+        char fromRanks[512];
+        char fromList[512];
+        TextWriter ranked(fromRanks, sizeof(fromRanks));
+        TextWriter listed(fromList, sizeof(fromList));
+        ComputerPlayer::shared().writeAdvice(ranked, ranks, 1000.0, count);
+        ComputerPlayer::shared().writeAdvice(listed, values, 1000.0, count);
+        CHECK(ranked.view() == listed.view());
+    }
+}
+
+// The console's lookahead agrees with the analyzer's exact optimum
+void testLookahead() {
+    const BasicBankModel<Cases>& bank = *findBankModel<Cases>("show");
+    CaseMask<Cases> position = 0x3f7b;     // 12 prizes: the first offer
+    PositionAnalyzer<Variant> analyzer(rules, bank, nullptr, 1);
+    BasicPositionAnalysis<Cases> analysis;
+    std::string error;
+    CHECK(analyzer.analyze(position, 1, analysis, error));
+
+    LookaheadTable<Variant> table;
+    std::atomic<bool> cancel(false);
+    CHECK(table.compute(rules, bank, position, cancel) && table.covers(position));
+    CHECK(std::fabs(table.optimalValue(position) - analysis.optimalValue) < 1e-6);
+    CHECK(std::fabs(table.playOnValue(position) - analysis.optimalFrom[1]) < 1e-6);
+
+    LookaheadWorker<Variant> worker(rules, bank);
+    CHECK(worker.wait(position) == nullptr);
+    worker.speculate(position);
+    const LookaheadTable<Variant>* done = worker.wait(0x3f3b);
+    CHECK(done && done->optimalValue(0x3f3b) == table.optimalValue(0x3f3b));
+}
+
+// The revolving-door preview sees the same offers as every mask in turn,
+// priced by mask (variance) and by running total (mean)
+void testOfferPreview() {
+    CaseMask<Cases> position = 0x7f7f;     // 14 prizes, 3 to open before round 2's offer
+    for (std::string_view name : {"variance", "mean"}) {
+        const BasicBankModel<Cases>& bank = *findBankModel<Cases>(name);
+        Cents current = bank.offer(rules, 1, position);
+        std::vector<Cents> offers;
+        for (std::uint32_t kept = 0; kept < (1u << Cases); kept++) {
+            if ((kept & ~position) == 0 && popcount32(kept) == 11) {
+                offers.push_back(bank.offer(rules, 2, static_cast<CaseMask<Cases>>(kept)));
+            }
+        }
+        std::sort(offers.begin(), offers.end());
+        Cents total = 0;
+        std::size_t higher = 0;
+        for (Cents offer : offers) {
+            total += offer;
+            higher += offer > current;
+        }
+
+        OfferPreview preview;
+        CHECK(previewNextOffer(rules, bank, 2, position, 3, current, preview));
+        CHECK(preview.ways == offers.size() && preview.ways == 364);
+        CHECK(preview.low == offers.front() && preview.high == offers.back());
+        CHECK(preview.median == offers[(offers.size() - 1) / 2]);
+        CHECK(preview.mean == toDollars(total) / offers.size());
+        CHECK(preview.beats == static_cast<double>(higher) / offers.size());
+    }
+    OfferPreview preview;
+    CHECK(!previewNextOffer(rules, *findBankModel<Cases>("mean"), 2, CaseMask<Cases>(0x7), 2, 0, preview));
+}
+
+void testTranspositionCache() {
+    struct Result {
+        Cents value;
+        int round;
+    };
+    using Cache = TranspositionCache<Result>;
+    Result result{};
+
+    // One bucket: the newest result takes the only slot a key has. Its
+    // entries are over-aligned and still counted as an allocation.
+    std::uint64_t allocated = alloc::threadAllocations();
+    Cache always(2 * Cache::EntryBytes, Replacement::Always, metrics::Cache::Preview);
+    CHECK(alloc::threadAllocations() == allocated + 1);
+    CHECK(always.capacity() == 2);
+    CHECK(!always.lookup(7, result));
+    CHECK(always.store(7, Result{700, 1}));
+    CHECK(always.lookup(7, result) && result.value == 700 && result.round == 1);
+    for (std::uint64_t key = 100; key < 120; key++) always.store(key, Result{static_cast<Cents>(key), 2});
+    CHECK(always.lookup(119, result) && result.value == 119);
+
+    // The costly result keeps its slot through a stream of cheap ones
+    Cache costly(2 * Cache::EntryBytes, Replacement::KeepCostly, metrics::Cache::Preview);
+    CHECK(costly.store(7, Result{700, 1}, 1000));
+    for (std::uint64_t key = 100; key < 120; key++) costly.store(key, Result{static_cast<Cents>(key), 2}, 1);
+    CHECK(costly.lookup(7, result) && result.value == 700);
+    CHECK(costly.lookup(119, result) && result.value == 119);
+    CHECK(!costly.lookup(100, result));
+
+    // Readers racing writers see whole results or miss
+    Cache shared(64 * Cache::EntryBytes, Replacement::KeepCostly, metrics::Cache::Preview);
+    std::atomic<int> torn{0};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&, t]() {
+            Result seen{};
+            for (std::uint64_t i = 0; i < 200000; i++) {
+                std::uint64_t key = 1 + (i * 7 + static_cast<std::uint64_t>(t)) % 256;
+                bool hit = shared.lookup(key, seen);
+                if (hit && (seen.value != static_cast<Cents>(key * 3) || seen.round != static_cast<int>(key))) torn++;
+                shared.store(key, Result{static_cast<Cents>(key * 3), static_cast<int>(key)}, key);
+            }
+        });
+    }
+    for (std::thread& thread : threads) thread.join();
+    CHECK(torn.load() == 0);
+
+    // A cached preview is the computed one
+    OfferPreviewCache previews(std::size_t(1) << 16, Replacement::KeepCostly, metrics::Cache::Preview);
+    const BasicBankModel<Cases>& bank = *findBankModel<Cases>("mean");
+    CaseMask<Cases> position = 0x7f7f;
+    Cents current = bank.offer(rules, 1, position);
+    OfferPreview expected;
+    OfferPreview cached;
+    CHECK(previewNextOffer(rules, bank, 2, position, 3, current, expected));
+    CHECK(previewNextOffer(rules, bank, &previews, 2, position, 3, current, cached));
+    CHECK(previewNextOffer(rules, bank, &previews, 2, position, 3, current, cached));
+    std::uint64_t key = position | std::uint64_t(2) << 32 | std::uint64_t(3) << 40 | std::uint64_t(1) << 48;
+    CHECK(previews.lookup(key, cached));
+    CHECK(cached.ways == expected.ways && cached.median == expected.median);
+    CHECK(cached.mean == expected.mean && cached.beats == expected.beats);
+}
+
+// Game i depends only on seed + i, so any split of a run into batches (as
+// SimulationRunner's threads make) gives the same totals
+void testSimulationDeterminism() {
+    BasicOfferTable<Cases> offers;
+    offers.bake(*findBankModel<Cases>("mean"), rules);
+    Simulator<Variant> simulator(rules, offers);
+
+    SimulationResult whole;
+    simulator.run(3000, 11, whole);
+    SimulationResult split;
+    simulator.run(1000, 11, split);
+    simulator.run(2000, 1011, split);
+
+    CHECK(whole.games == 3000 && split.games == 3000);
+    CHECK(whole.deals == split.deals);
+    CHECK(whole.totalPayout == split.totalPayout);
+    CHECK(whole.totalPayout != CentsTotal());
+    for (int r = 0; r < MaxScheduleRounds; r++) {
+        CHECK(whole.reachedRound[r] == split.reachedRound[r]);
+        CHECK(whole.dealsInRound[r] == split.dealsInRound[r]);
+    }
+}
+
+void testSessionProtocol() {
+    using Session = BasicGameSession<Variant>;
+    Session session;
+    const BasicBankModel<Cases>& bank = *findBankModel<Cases>("mean");
+    std::uint64_t seedState = 1;
+    char buffer[256];
+    OfferPreviewCache previews(std::size_t(1) << 16, Replacement::KeepCostly, metrics::Cache::Preview);
+    auto send = [&](std::string_view line, OfferPreviewCache* cache = nullptr) {
+        TextWriter reply(buffer, sizeof(buffer));
+        session.handle(rules, bank, line, reply, ComputerPlayer::shared(), seedState, cache);
+        return std::string(reply.view());
+    };
+
+    CHECK(send("OPEN 3") == "ERR not opening cases");
+    CHECK(send("NEW x") == "ERR bad seed");
+    CHECK(send("new 42") == "OK NEW CHOOSE 1-16");
+    CHECK(send("CASE 17") == "ERR Input out of range");
+    CHECK(send("CASE 1").rfind("OK CASE 1 ROUND 1", 0) == 0);
+    CHECK(send("OPEN 1") == "ERR cannot open your own case");
+    CHECK(send("STATE") == "OK STATE OPEN ROUND 1 REMAINING 16");
+    std::string preview = send("PREVIEW");
+    CHECK(preview.rfind("OK PREVIEW ROUND 1 WAYS 1820 LOW ", 0) == 0);
+    CHECK(send("PREVIEW", &previews) == preview && send("PREVIEW", &previews) == preview);
+    CHECK(send("BOGUS") == "ERR unknown command");
+    CHECK(send("QUIT") == "OK BYE" && session.wantsClose());
+}
+
+void testCompactRecord() {
+    // Random games survive the round trip through 32 bytes
+    std::uint64_t state = 5;
+    int mismatches = 0;
+    for (int sample = 0; sample < 2000; sample++) {
+        compact::GameLayout game = {};
+        for (int i = 0; i < compact::Cases; i++) game.casePrize[i] = static_cast<std::uint8_t>(i);
+        replay::shuffleWithSeed(replay::splitMix64(state), game.casePrize, compact::Cases);
+        std::uint8_t order[compact::Cases];
+        for (int i = 0; i < compact::Cases; i++) order[i] = static_cast<std::uint8_t>(i);
+        replay::shuffleWithSeed(replay::splitMix64(state), order, compact::Cases);
+        game.playerCase = order[compact::Slots];
+        game.roundCount = static_cast<std::uint8_t>(replay::splitMix64(state) % (compact::Rounds + 1));
+        for (int r = 0; r < game.roundCount; r++) {
+            int count = std::min<int>(static_cast<int>(replay::splitMix64(state) % 8), compact::Slots - game.openedCount);
+            game.openedPerRound[r] = static_cast<std::uint8_t>(count);
+            game.openedCount = static_cast<std::uint8_t>(game.openedCount + count);
+        }
+        for (int i = 0; i < game.openedCount; i++) game.openOrder[i] = order[i];
+        game.dealRound = static_cast<std::uint8_t>(replay::splitMix64(state) % (game.roundCount + 1));
+
+        compact::GameRecord record;
+        compact::GameLayout back;
+        CHECK(compact::encode(game, record));
+        compact::decode(record, back);
+        bool same = back.playerCase == game.playerCase && back.openedCount == game.openedCount
+                 && back.roundCount == game.roundCount && back.dealRound == game.dealRound
+                 && std::equal(game.casePrize, game.casePrize + compact::Cases, back.casePrize)
+                 && std::equal(game.openOrder, game.openOrder + game.openedCount, back.openOrder)
+                 && std::equal(game.openedPerRound, game.openedPerRound + game.roundCount, back.openedPerRound);
+        if (!same) mismatches++;
+    }
+    CHECK(mismatches == 0);
+
+    compact::GameLayout bad = {};
+    compact::GameRecord record;
+    bad.playerCase = compact::Cases;
+    CHECK(!compact::encode(bad, record));
+    bad.playerCase = 4;
+    bad.openedCount = 1;
+    bad.openOrder[0] = 4;
+    CHECK(!compact::encode(bad, record));
+
+    // Simulated games are archived as played: the first case of the deal
+    // order is the player's and the rest are opened front to back
+    BasicGameRules<compact::Cases> shortRules = BuiltinRules<StandardVariant>;
+    shortRules.rounds = 3;
+    shortRules.casesPerRound[0] = 2;
+    shortRules.casesPerRound[1] = 1;
+    shortRules.casesPerRound[2] = 1;
+    CHECK(Simulator<StandardVariant>::archivable(shortRules) && !Simulator<Variant>::archivable(rules));
+    BasicOfferTable<compact::Cases> offers;
+    offers.bake(*findBankModel<compact::Cases>("mean"), shortRules);
+    Simulator<StandardVariant> simulator(shortRules, offers);
+    std::vector<compact::GameRecord> records(500);
+    SimulationResult result;
+    simulator.run(500, 3, result, records.data());
+
+    std::uint8_t order[compact::Cases];
+    for (int i = 0; i < compact::Cases; i++) order[i] = static_cast<std::uint8_t>(i);
+    replay::shuffleWithSeed(3, order, compact::Cases);
+    compact::GameLayout first;
+    compact::decode(records[0], first);
+    CHECK(first.playerCase == order[0] && first.openedCount >= 2);
+    CHECK(first.openOrder[0] == order[1] && first.openOrder[1] == order[2]);
+
+    long long deals = 0;
+    int inconsistent = 0;
+    for (const compact::GameRecord& archived : records) {
+        compact::GameLayout game;
+        compact::decode(archived, game);
+        int opened = 0;
+        for (int r = 0; r < game.roundCount; r++) opened += game.openedPerRound[r];
+        if (opened != game.openedCount || game.casePrize[7] != 7) inconsistent++;
+        if (game.dealRound != 0) deals++;
+    }
+    CHECK(inconsistent == 0 && deals == result.deals);
+
+    // Batches split over threads decode exactly as one record at a time
+    std::vector<compact::GameRecord> batch;
+    while (batch.size() < 3 * 4096) batch.insert(batch.end(), records.begin(), records.end());
+    std::vector<compact::GameLayout> many(batch.size()), single(batch.size());
+    compact::decodeMany(batch.data(), batch.size(), many.data(), 3);
+    for (std::size_t i = 0; i < batch.size(); i++) compact::decode(batch[i], single[i]);
+    CHECK(std::memcmp(many.data(), single.data(), many.size() * sizeof(compact::GameLayout)) == 0);
+}
+
+void testReplayIndex() {
+    const std::string path = "core_tests_replay.dmr";
+    std::remove(path.c_str());
+    std::remove(replay::indexPath(path).c_str());
+    auto game = [](int number) {
+        replay::GameLog log;
+        log.begin(1000 + static_cast<std::uint64_t>(number), replay::PlayMode::Computer, number % Cases);
+        log.beginRound();
+        log.openCase((number + 1) % Cases);
+        log.offer(number * 100, true);
+        return log;
+    };
+    {
+        replay::ReplayWriter writer(path);
+        for (int i = 0; i < 50; i++) writer.append(game(i));
+    }
+    replay::ReplayReader reader;
+    replay::GameLog loaded;
+    CHECK(reader.open(path) && reader.size() == 50);
+    CHECK(reader.load(37, loaded) && loaded.seed == 1037 && loaded.offerCents[0] == 3700);
+    CHECK(!reader.load(50, loaded));
+
+    // A lost index is rebuilt, records appended without it are caught up
+    std::remove(replay::indexPath(path).c_str());
+    {
+        std::ofstream log(path, std::ios::binary | std::ios::app);
+        std::uint8_t record[replay::MaxRecordBytes];
+        std::size_t size = replay::encodeGame(game(50), record, sizeof(record));
+        log.put(static_cast<char>(size));
+        log.write(reinterpret_cast<const char*>(record), static_cast<std::streamsize>(size));
+    }
+    {
+        replay::ReplayWriter writer(path);
+        writer.append(game(51));
+    }
+    CHECK(reader.open(path) && reader.size() == 52);
+    CHECK(reader.load(50, loaded) && loaded.seed == 1050);
+    CHECK(reader.load(51, loaded) && loaded.seed == 1051);
+
+    // A length prefix of more than ten bytes ends the log
+    {
+        std::ofstream log(path, std::ios::binary | std::ios::app);
+        for (int i = 0; i < 11; i++) log.put(static_cast<char>(0x80));
+        log.put(1);
+    }
+    CHECK(reader.open(path) && reader.size() == 52);
+    std::uint8_t overlong[11];
+    for (std::uint8_t& byte : overlong) byte = 0xFF;
+    replay::BitReader bits(overlong, sizeof(overlong));
+    bits.readVarint();
+    CHECK(bits.failed());
+
+    std::remove(path.c_str());
+    std::remove(replay::indexPath(path).c_str());
+}
+
+} // namespace
+
+int main() {
+    testParseInt();
+    testMoney();
+    testOfferTable();
+    testAdvice();
+    testPrizeRanks();
+    testLookahead();
+    testOfferPreview();
+    testTranspositionCache();
+    testSimulationDeterminism();
+    testSessionProtocol();
+    testCompactRecord();
+    testReplayIndex();
+    if (failures > 0) {
+        std::cout << failures << " check(s) failed" << std::endl;
+        return 1;
+    }
+    std::cout << "All checks passed" << std::endl;
+    return 0;
+}
@@ -0,0 +1,87 @@
+#ifndef DEALMASTER_TEXT_WRITER_H
+#define DEALMASTER_TEXT_WRITER_H
+
+#include <charconv>
+#include <cstddef>
+#include <cstring>
+#include <string_view>
+
+#include "money.h"
+
+// Formats text into a caller-owned buffer (e.g. a connection's output
+// buffer). Like FrameBuffer but never touches a file descriptor; output
+// that does not fit is dropped and reported through overflowed().
+class TextWriter {
+private:
+    char* data;
+    std::size_t capacity;
+    std::size_t length;
+    bool overflow;
+
+public:
+    TextWriter(char* buffer, std::size_t bytes) : data(buffer), capacity(bytes), length(0), overflow(false) {}
+
+    TextWriter& put(std::string_view text) {
+        if (text.size() > capacity - length) {
+            overflow = true;
+            return *this;
+        }
+        std::memcpy(data + length, text.data(), text.size());
+        length += text.size();
+        return *this;
+    }
+
+    TextWriter& put(char ch) {
+        if (length == capacity) {
+            overflow = true;
+            return *this;
+        }
+        data[length++] = ch;
+        return *this;
+    }
+
+    TextWriter& putInt(long long value) {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        return put(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+    }
+
+    TextWriter& putUnsigned(unsigned long long value) {
+        char digits[24];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value);
+        return put(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+    }
+
+    TextWriter& putFixed(double value, int precision) {
+        char digits[352];
+        std::to_chars_result result = std::to_chars(digits, digits + sizeof(digits), value,
+                                                    std::chars_format::fixed, precision);
+        if (result.ec != std::errc()) return put('?');
+        return put(std::string_view(digits, static_cast<std::size_t>(result.ptr - digits)));
+    }
+
+    // Amount in cents as exact decimal dollars, e.g. "1234.50"
+    TextWriter& putCents(Cents amount) {
+        if (amount < 0) {
+            put('-');
+            amount = -amount;
+        }
+        putInt(amount / 100).put('.');
+        return put(static_cast<char>('0' + amount / 10 % 10)).put(static_cast<char>('0' + amount % 10));
+    }
+
+    std::size_t size() const {
+        return length;
+    }
+
+    // The text written so far
+    std::string_view view() const {
+        return std::string_view(data, length);
+    }
+
+    bool overflowed() const {
+        return overflow;
+    }
+};
+
+#endif // DEALMASTER_TEXT_WRITER_H
@@ -0,0 +1,297 @@
+#ifndef DEALMASTER_TRACE_EVENTS_H
+#define DEALMASTER_TRACE_EVENTS_H
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+
+#include "text_writer.h"
+
+// Timeline tracing in the Chrome trace event format (chrome://tracing,
+// ui.perfetto.dev).
+//
+// A Span records one complete event ("ph":"X") for its scope, on the
+// calling thread. Events go into a ring owned by that thread with a plain
+// store and a release of the head index; the rings are drained by a
+// TraceWriter thread every few milliseconds, so the traced code never
+// formats, locks or writes a file. A full ring drops events (counted in
+// the trace) rather than wait. When no trace is open, a Span is one
+// relaxed load.
+//
+// Event names and categories must be string literals: only the pointers
+// are stored.
+namespace trace {
+
+inline constexpr std::int64_t NoValue = INT64_MIN;
+
+struct Event {
+    const char* name;
+    const char* category;
+    const char* argName;        // Name of `value` in "args", or nullptr
+    std::int64_t value;
+    std::uint64_t start;        // Nanoseconds since the trace opened
+    std::uint64_t duration;
+    char kind;                  // 'X' complete, 'i' instant
+};
+
+// Single-producer, single-consumer ring of one thread's events. A thread
+// that exits hands its ring back for the next new thread, so pools of
+// short-lived workers reuse a few rings (each ring is one "thread" row in
+// the viewer).
+class EventRing {
+public:
+    static constexpr std::size_t Capacity = 8192;
+
+private:
+    Event events[Capacity];
+    std::atomic<std::uint64_t> head{0};     // Written by the owning thread
+    std::atomic<std::uint64_t> tail{0};     // Written by the TraceWriter
+
+public:
+    std::atomic<std::uint64_t> dropped{0};
+    std::atomic<bool> owned{true};
+    std::uint32_t id = 0;
+    char threadName[32] = {};
+    std::atomic<bool> nameChanged{false};
+    EventRing* next = nullptr;
+
+    void push(const Event& event) {
+        std::uint64_t position = head.load(std::memory_order_relaxed);
+        if (position - tail.load(std::memory_order_acquire) >= Capacity) {
+            dropped.store(dropped.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+            return;
+        }
+        events[position % Capacity] = event;
+        head.store(position + 1, std::memory_order_release);
+    }
+
+    template <class Visit>
+    void drain(const Visit& visit) {
+        std::uint64_t end = head.load(std::memory_order_acquire);
+        std::uint64_t position = tail.load(std::memory_order_relaxed);
+        for (; position < end; position++) visit(events[position % Capacity]);
+        tail.store(end, std::memory_order_release);
+    }
+};
+
+namespace detail {
+
+inline std::atomic<bool> active{false};
+inline std::atomic<EventRing*> rings{nullptr};
+inline std::atomic<std::uint32_t> ringCount{0};
+inline std::atomic<std::int64_t> epochNanoseconds{0};
+
+inline std::int64_t clockNanoseconds() {
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Claim a ring another thread has given back, or add a new one
+inline EventRing* claimRing() {
+    for (EventRing* ring = rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+        bool expected = false;
+        if (ring->owned.compare_exchange_strong(expected, true, std::memory_order_acquire)) return ring;
+    }
+    EventRing* ring = new EventRing();
+    ring->id = ringCount.fetch_add(1, std::memory_order_relaxed) + 1;
+    ring->next = rings.load(std::memory_order_relaxed);
+    while (!rings.compare_exchange_weak(ring->next, ring, std::memory_order_release, std::memory_order_relaxed)) {
+    }
+    return ring;
+}
+
+// The calling thread's ring, returned when the thread exits
+class RingLease {
+private:
+    EventRing* ring = nullptr;
+
+public:
+    ~RingLease() {
+        if (ring) ring->owned.store(false, std::memory_order_release);
+    }
+
+    EventRing& get() {
+        if (!ring) ring = claimRing();
+        return *ring;
+    }
+};
+
+inline thread_local RingLease lease;
+
+} // namespace detail
+
+inline bool enabled() {
+    return detail::active.load(std::memory_order_relaxed);
+}
+
+inline std::uint64_t now() {
+    return static_cast<std::uint64_t>(detail::clockNanoseconds() - detail::epochNanoseconds.load(std::memory_order_relaxed));
+}
+
+// Label the calling thread's row (e.g. "shard 2")
+inline void nameThread(const std::string& name) {
+    if (!enabled()) return;
+    EventRing& ring = detail::lease.get();
+    std::size_t length = std::min(name.size(), sizeof(ring.threadName) - 1);
+    std::memcpy(ring.threadName, name.data(), length);
+    ring.threadName[length] = '\0';
+    ring.nameChanged.store(true, std::memory_order_release);
+}
+
+inline void instant(const char* name, const char* category, const char* argName = nullptr,
+                    std::int64_t value = NoValue) {
+    if (!enabled()) return;
+    detail::lease.get().push(Event{name, category, argName, value, now(), 0, 'i'});
+}
+
+// Records its own lifetime as one complete event
+class Span {
+private:
+    const char* name;
+    const char* category;
+    const char* argName;
+    std::int64_t value;
+    std::uint64_t started;
+    bool recording;
+
+public:
+    Span(const char* spanName, const char* spanCategory, const char* valueName = nullptr,
+         std::int64_t spanValue = NoValue)
+        : name(spanName), category(spanCategory), argName(valueName), value(spanValue), started(0),
+          recording(enabled()) {
+        if (recording) started = now();
+    }
+
+    ~Span() {
+        if (!recording) return;
+        std::uint64_t ended = now();
+        detail::lease.get().push(Event{name, category, argName, value, started, ended - started, 'X'});
+    }
+
+    Span(const Span&) = delete;
+    Span& operator=(const Span&) = delete;
+};
+
+// Owns the trace file and the thread that drains the rings into it
+class TraceWriter {
+public:
+    static constexpr int FlushMilliseconds = 20;
+
+private:
+    std::FILE* file;
+    std::thread worker;
+    std::mutex mutex;
+    std::condition_variable wake;
+    bool stopping;
+    bool firstEvent;
+    std::uint64_t written;
+    char line[512];
+
+    void write(TextWriter& text) {
+        std::fwrite(line, 1, text.size(), file);
+        written++;
+    }
+
+    void separator(TextWriter& text) {
+        text.put(firstEvent ? "\n" : ",\n");
+        firstEvent = false;
+    }
+
+    void drainAll() {
+        for (EventRing* ring = detail::rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+            if (ring->nameChanged.exchange(false, std::memory_order_acquire)) {
+                TextWriter text(line, sizeof(line));
+                separator(text);
+                text.put("{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":").putUnsigned(ring->id);
+                text.put(",\"args\":{\"name\":\"").put(ring->threadName).put("\"}}");
+                write(text);
+            }
+            ring->drain([&](const Event& event) {
+                TextWriter text(line, sizeof(line));
+                separator(text);
+                text.put("{\"name\":\"").put(event.name).put("\",\"cat\":\"").put(event.category);
+                text.put("\",\"ph\":\"").put(event.kind).put("\",\"pid\":1,\"tid\":").putUnsigned(ring->id);
+                text.put(",\"ts\":").putFixed(event.start / 1000.0, 3);
+                if (event.kind == 'X') text.put(",\"dur\":").putFixed(event.duration / 1000.0, 3);
+                if (event.kind == 'i') text.put(",\"s\":\"t\"");
+                if (event.argName) text.put(",\"args\":{\"").put(event.argName).put("\":").putInt(event.value).put('}');
+                text.put('}');
+                write(text);
+            });
+        }
+    }
+
+    void run() {
+        std::unique_lock<std::mutex> lock(mutex);
+        while (!stopping) {
+            wake.wait_for(lock, std::chrono::milliseconds(FlushMilliseconds));
+            lock.unlock();
+            drainAll();
+            lock.lock();
+        }
+    }
+
+public:
+    TraceWriter() : file(nullptr), stopping(false), firstEvent(true), written(0) {}
+
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    ~TraceWriter() {
+        close();
+    }
+
+    // Start tracing into `path`; one trace can be open at a time
+    bool open(const std::string& path) {
+        if (file || detail::active.load()) return false;
+        file = std::fopen(path.c_str(), "wb");
+        if (!file) return false;
+        std::fputs("{\"displayTimeUnit\":\"ns\",\"traceEvents\":[", file);
+        detail::epochNanoseconds.store(detail::clockNanoseconds(), std::memory_order_relaxed);
+        detail::active.store(true, std::memory_order_release);
+        worker = std::thread([this]() { run(); });
+        return true;
+    }
+
+    // Stop tracing, write what is left and close the file. Events still
+    // being recorded by other threads at this point may be lost.
+    void close() {
+        if (!file) return;
+        detail::active.store(false, std::memory_order_release);
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_one();
+        worker.join();
+        drainAll();
+
+        std::uint64_t dropped = 0;
+        for (EventRing* ring = detail::rings.load(std::memory_order_acquire); ring; ring = ring->next) {
+            dropped += ring->dropped.exchange(0, std::memory_order_relaxed);
+        }
+        TextWriter text(line, sizeof(line));
+        separator(text);
+        text.put("{\"name\":\"dropped_events\",\"ph\":\"M\",\"pid\":1,\"args\":{\"count\":").putUnsigned(dropped);
+        text.put("}}\n]}\n");
+        write(text);
+        std::fclose(file);
+        file = nullptr;
+    }
+
+    std::uint64_t events() const {
+        return written;
+    }
+};
+
+} // namespace trace
+
+#endif // DEALMASTER_TRACE_EVENTS_H
@@ -0,0 +1,142 @@
+#ifndef DEALMASTER_TRANSPOSITION_CACHE_H
+#define DEALMASTER_TRANSPOSITION_CACHE_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <type_traits>
+
+#include "metrics.h"
+
+// How a full cache makes room for a new result
+enum class Replacement : std::uint8_t {
+    Always,         // One slot per key, the newest result takes it
+    KeepCostly      // Buckets of two slots: the first keeps the costliest result, the second the newest
+};
+
+// Results of expensive computations keyed by game state, shared by every
+// thread that makes them (the server's shards all preview the same opening
+// round, and most of the rounds after it). The size is fixed when the cache
+// is made and a full cache replaces entries by its Replacement policy.
+//
+// Game states are small enough to be their own keys (a prize mask of at
+// most 26 bits and a few counters), so an entry holds the whole key and a
+// hit is never a collision; the key is hashed only to find its slot.
+// Entries are sequence locks: a writer claims an entry by making its
+// sequence odd, writes it and makes the sequence even again, and a reader
+// keeps its copy of an entry only if the sequence was even and unchanged
+// around it. Nobody waits: a reader that races a writer misses, and a
+// writer that finds an entry claimed drops its result.
+template <class Value>
+class TranspositionCache {
+    static_assert(std::is_trivially_copyable<Value>::value, "Cached values are copied word by word");
+
+public:
+    static constexpr std::size_t Words = (sizeof(Value) + 7) / 8;
+
+private:
+    struct alignas(64) Entry {
+        std::atomic<std::uint64_t> sequence{0};     // Odd while being written, 0 if never written
+        std::atomic<std::uint64_t> key{0};
+        std::atomic<std::uint64_t> cost{0};
+        std::atomic<std::uint64_t> words[Words] = {};
+    };
+
+    std::unique_ptr<Entry[]> entries;
+    std::size_t slots;
+    Replacement policy;
+    metrics::Cache label;
+
+    // SplitMix64's finalizer, so neighbouring masks land far apart
+    static std::uint64_t mix(std::uint64_t key) {
+        key = (key ^ (key >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        key = (key ^ (key >> 27)) * 0x94D049BB133111EBULL;
+        return key ^ (key >> 31);
+    }
+
+    Entry& first(std::uint64_t key) const {
+        std::size_t slot = static_cast<std::size_t>(mix(key)) & (slots - 1);
+        return entries[policy == Replacement::KeepCostly ? slot & ~std::size_t(1) : slot];
+    }
+
+    static bool read(const Entry& entry, std::uint64_t key, Value& value) {
+        std::uint64_t before = entry.sequence.load(std::memory_order_acquire);
+        if (before == 0 || (before & 1) || entry.key.load(std::memory_order_relaxed) != key) return false;
+        std::uint64_t copy[Words];
+        for (std::size_t i = 0; i < Words; i++) copy[i] = entry.words[i].load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (entry.sequence.load(std::memory_order_relaxed) != before) return false;
+        std::memcpy(&value, copy, sizeof(Value));
+        return true;
+    }
+
+    static bool write(Entry& entry, std::uint64_t key, const Value& value, std::uint64_t cost) {
+        std::uint64_t before = entry.sequence.load(std::memory_order_relaxed);
+        if ((before & 1) || !entry.sequence.compare_exchange_strong(before, before + 1, std::memory_order_relaxed)) {
+            return false;
+        }
+        std::atomic_thread_fence(std::memory_order_release);
+        std::uint64_t copy[Words] = {};
+        std::memcpy(copy, &value, sizeof(Value));
+        entry.key.store(key, std::memory_order_relaxed);
+        entry.cost.store(cost, std::memory_order_relaxed);
+        for (std::size_t i = 0; i < Words; i++) entry.words[i].store(copy[i], std::memory_order_relaxed);
+        entry.sequence.store(before + 2, std::memory_order_release);
+        return true;
+    }
+
+public:
+    static constexpr std::size_t EntryBytes = sizeof(Entry);
+
+    // A cache of at most `bytes` (and at least one bucket) whose lookups
+    // are counted as `which` while metrics are on
+    TranspositionCache(std::size_t bytes, Replacement replacement, metrics::Cache which)
+        : slots(2), policy(replacement), label(which) {
+        while (slots * 2 * sizeof(Entry) <= bytes) slots *= 2;
+        entries.reset(new Entry[slots]);
+    }
+
+    TranspositionCache(const TranspositionCache&) = delete;
+    TranspositionCache& operator=(const TranspositionCache&) = delete;
+
+    std::size_t capacity() const {
+        return slots;
+    }
+
+    std::size_t bytes() const {
+        return slots * sizeof(Entry);
+    }
+
+    // Copy the result stored for `key` into `value`; false on a miss
+    bool lookup(std::uint64_t key, Value& value) const {
+        Entry& entry = first(key);
+        bool hit = read(entry, key, value)
+                || (policy == Replacement::KeepCostly && read((&entry)[1], key, value));
+        if (metrics::enabled()) {
+            metrics::ThreadMetrics& block = metrics::local();
+            metrics::bump(hit ? block.cacheHits[static_cast<int>(label)] : block.cacheMisses[static_cast<int>(label)]);
+        }
+        return hit;
+    }
+
+    // Keep `value` as the result for `key`; `cost` is the work it saves
+    // (KeepCostly only). False if the result was dropped.
+    bool store(std::uint64_t key, const Value& value, std::uint64_t cost = 0) {
+        Entry* entry = &first(key);
+        if (policy == Replacement::KeepCostly) {
+            // The first slot goes to a result at least as costly as the one
+            // it holds, or to a newer result for the same key
+            std::uint64_t held = entry->sequence.load(std::memory_order_relaxed);
+            bool take = held == 0 || entry->key.load(std::memory_order_relaxed) == key
+                     || cost >= entry->cost.load(std::memory_order_relaxed);
+            if (!take) entry++;
+        }
+        bool stored = write(*entry, key, value, cost);
+        if (stored && metrics::enabled()) metrics::bump(metrics::local().cacheStores[static_cast<int>(label)]);
+        return stored;
+    }
+};
+
+#endif // DEALMASTER_TRANSPOSITION_CACHE_H
@@ -0,0 +1,326 @@
+#ifndef DEALMASTER_VARIANT_RULES_H
+#define DEALMASTER_VARIANT_RULES_H
+
+#include <algorithm>
+#include <charconv>
+#include <cmath>
+#include <cstddef>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "game_rules.h"
+#include "game_variants.h"
+#include "prize_board.h"
+
+// Runtime rules of a show format, flattened into the tables the game
+// loops read: the prize board (values, cents, prefix sums), the cases
+// opened in each round and the bank's offer multiplier for each round.
+//
+// The board size stays a compile-time parameter: a compiled variant (see
+// game_variants.h) supplies the fixed-size code path, and the rules for it
+// come either from that variant's built-in defaults or from a variant
+// file read once at startup. Changing prizes, schedule or offer curve
+// therefore needs no recompile, and the hot path is the same table lookup
+// either way.
+
+inline constexpr int MaxScheduleRounds = 9;
+
+template <int N>
+struct BasicGameRules {
+    static constexpr int Cases = N;
+
+    char name[32];
+    int columns;                                    // Cases per row on the console board
+    int rounds;
+    int casesPerRound[MaxScheduleRounds];
+    double offerMultiplier[MaxScheduleRounds];      // Share of the average remaining prize offered after round r + 1
+    bool finalSwap;                                 // After the last "no deal", may swap for the other case
+    bool builtin;                                   // Compiled defaults rather than a variant file
+    BasicPrizeBoard<N> board;
+};
+
+template <class Variant>
+constexpr BasicGameRules<Variant::Cases> makeBuiltinRules() {
+    BasicGameRules<Variant::Cases> rules{};
+    for (std::size_t i = 0; i < Variant::Name.size() && i + 1 < sizeof(rules.name); i++) {
+        rules.name[i] = Variant::Name[i];
+    }
+    rules.columns = Variant::BoardColumns;
+    rules.rounds = Variant::Rounds;
+    for (int r = 0; r < Variant::Rounds; r++) {
+        rules.casesPerRound[r] = Variant::CasesPerRound[r];
+        rules.offerMultiplier[r] = bankOfferPercentage(r + 1);
+    }
+    rules.finalSwap = false;
+    rules.builtin = true;
+    rules.board = makePrizeBoard(Variant::Prizes);
+    return rules;
+}
+
+// Compiled defaults of each variant
+template <class Variant>
+inline constexpr BasicGameRules<Variant::Cases> BuiltinRules = makeBuiltinRules<Variant>();
+
+using GameRules = BasicGameRules<StandardVariant::Cases>;
+
+// Board of the standard show; replay logs are always recorded against it
+inline constexpr const PrizeBoard& StandardBoard = BuiltinRules<StandardVariant>.board;
+
+// A variant file as written, before it is matched to a compiled board size.
+//
+//     # Comments start with '#'
+//     name     = regional22
+//     columns  = 11
+//     prizes   = 0.01 0.10 0.50 1 5 10 ...
+//     schedule = 5 3 3 3 3 3
+//     offer    = 0.15 0.20 0.25 0.30 0.35 0.40      # one multiplier per round, or
+//     offer.base = 0.10                               # base + step * round,
+//     offer.step = 0.05
+//     offer.cap  = 0.90                               # ...capped
+//     swap     = yes                                  # final case swap (default no)
+//
+// Values may be separated by spaces or commas; each key appears on its own line.
+struct VariantSpec {
+    std::string name = "custom";
+    int columns = 0;                    // 0 = half the board, rounded up
+    std::vector<double> prizes;
+    std::vector<int> schedule;
+    std::vector<double> offers;         // Explicit per-round multipliers (optional)
+    double offerBase = OFFER_BASE;
+    double offerStep = OFFER_STEP;
+    double offerCap = OFFER_CAP;
+    bool finalSwap = false;
+};
+
+namespace rules_detail {
+
+inline std::string_view trim(std::string_view text) {
+    while (!text.empty() && (text.front() == ' ' || text.front() == '\t' || text.front() == '\r')) text.remove_prefix(1);
+    while (!text.empty() && (text.back() == ' ' || text.back() == '\t' || text.back() == '\r')) text.remove_suffix(1);
+    return text;
+}
+
+template <typename T>
+bool parseList(std::string_view text, std::vector<T>& values) {
+    values.clear();
+    std::size_t i = 0;
+    while (i < text.size()) {
+        while (i < text.size() && (text[i] == ' ' || text[i] == '\t' || text[i] == ',')) i++;
+        std::size_t begin = i;
+        while (i < text.size() && text[i] != ' ' && text[i] != '\t' && text[i] != ',') i++;
+        if (i == begin) break;
+        T value{};
+        std::from_chars_result result = std::from_chars(text.data() + begin, text.data() + i, value);
+        if (result.ec != std::errc() || result.ptr != text.data() + i) return false;
+        values.push_back(value);
+    }
+    return !values.empty();
+}
+
+template <typename T>
+bool parseSingle(std::string_view text, T& value) {
+    std::vector<T> values;
+    if (!parseList(text, values) || values.size() != 1) return false;
+    value = values[0];
+    return true;
+}
+
+inline std::string lineError(int line, const std::string& message) {
+    return "line " + std::to_string(line) + ": " + message;
+}
+
+} // namespace rules_detail
+
+// Parse variant file text; on failure `error` names the offending line
+inline bool parseVariantSpec(std::string_view text, VariantSpec& spec, std::string& error) {
+    using namespace rules_detail;
+    spec = VariantSpec();
+    int lineNumber = 0;
+    std::size_t start = 0;
+
+    while (start < text.size()) {
+        std::size_t end = text.find('\n', start);
+        if (end == std::string_view::npos) end = text.size();
+        std::string_view line = text.substr(start, end - start);
+        start = end + 1;
+        lineNumber++;
+
+        std::size_t comment = line.find('#');
+        if (comment != std::string_view::npos) line = line.substr(0, comment);
+        line = trim(line);
+        if (line.empty()) continue;
+
+        std::size_t equals = line.find('=');
+        if (equals == std::string_view::npos) {
+            error = lineError(lineNumber, "expected 'key = value'");
+            return false;
+        }
+        std::string_view key = trim(line.substr(0, equals));
+        std::string_view value = trim(line.substr(equals + 1));
+
+        bool ok = true;
+        if (key == "name") {
+            ok = !value.empty() && value.size() < sizeof(BasicGameRules<4>::name);
+            spec.name = std::string(value);
+        } else if (key == "columns") {
+            ok = parseSingle(value, spec.columns);
+        } else if (key == "prizes") {
+            ok = parseList(value, spec.prizes);
+        } else if (key == "schedule") {
+            ok = parseList(value, spec.schedule);
+        } else if (key == "offer") {
+            ok = parseList(value, spec.offers);
+        } else if (key == "offer.base") {
+            ok = parseSingle(value, spec.offerBase);
+        } else if (key == "offer.step") {
+            ok = parseSingle(value, spec.offerStep);
+        } else if (key == "offer.cap") {
+            ok = parseSingle(value, spec.offerCap);
+        } else if (key == "swap") {
+            ok = value == "yes" || value == "no";
+            spec.finalSwap = value == "yes";
+        } else {
+            error = lineError(lineNumber, "unknown key '" + std::string(key) + "'");
+            return false;
+        }
+        if (!ok) {
+            error = lineError(lineNumber, "invalid value for '" + std::string(key) + "'");
+            return false;
+        }
+    }
+    return true;
+}
+
+// Check a spec against the rules every front-end relies on
+inline bool validateVariantSpec(const VariantSpec& spec, std::string& error) {
+    int cases = static_cast<int>(spec.prizes.size());
+    bool compiled = false;
+    std::string sizes;
+    forEachVariant([&](auto variant) {
+        using Variant = decltype(variant);
+        if (Variant::Cases == cases) compiled = true;
+        if (sizes.find(std::to_string(Variant::Cases)) == std::string::npos) {
+            sizes += (sizes.empty() ? "" : ", ") + std::to_string(Variant::Cases);
+        }
+    });
+    if (!compiled) {
+        error = "prizes: " + std::to_string(cases) + " prizes given; compiled board sizes are " + sizes;
+        return false;
+    }
+    for (double prize : spec.prizes) {
+        if (!std::isfinite(prize) || prize < 0.0 || prize > 1e12) {
+            error = "prizes: values must be between 0 and 1e12";
+            return false;
+        }
+    }
+
+    int rounds = static_cast<int>(spec.schedule.size());
+    if (rounds < 1 || rounds > MaxScheduleRounds) {
+        error = "schedule: between 1 and " + std::to_string(MaxScheduleRounds) + " rounds required";
+        return false;
+    }
+    int opened = 0;
+    for (int count : spec.schedule) {
+        if (count < 1 || count > 7) {
+            error = "schedule: each round opens 1 to 7 cases";
+            return false;
+        }
+        opened += count;
+    }
+    if (opened != cases - 2) {
+        error = "schedule: must open " + std::to_string(cases - 2) + " cases in total (opens "
+              + std::to_string(opened) + ")";
+        return false;
+    }
+
+    if (!spec.offers.empty() && static_cast<int>(spec.offers.size()) != rounds) {
+        error = "offer: one multiplier per round required";
+        return false;
+    }
+    for (int r = 0; r < rounds; r++) {
+        double multiplier = spec.offers.empty()
+            ? std::min(spec.offerCap, spec.offerBase + ((r + 1) * spec.offerStep))
+            : spec.offers[r];
+        if (!(multiplier > 0.0 && multiplier <= 2.0)) {
+            error = "offer: multipliers must be in (0, 2]";
+            return false;
+        }
+    }
+
+    if (spec.columns < 0 || spec.columns > cases) {
+        error = "columns: must be between 0 (half the board) and the number of cases";
+        return false;
+    }
+    return true;
+}
+
+// Read, parse and validate a variant file
+inline bool loadVariantFile(const std::string& path, VariantSpec& spec, std::string& error) {
+    std::ifstream file(path, std::ios::binary);
+    if (!file.is_open()) {
+        error = "cannot open " + path;
+        return false;
+    }
+    std::ostringstream text;
+    text << file.rdbuf();
+    if (!parseVariantSpec(text.str(), spec, error) || !validateVariantSpec(spec, error)) {
+        error = path + ": " + error;
+        return false;
+    }
+    return true;
+}
+
+// Flatten a validated spec into the tables for a board of N cases
+template <int N>
+void buildRules(const VariantSpec& spec, BasicGameRules<N>& rules) {
+    rules = BasicGameRules<N>{};
+    std::strncpy(rules.name, spec.name.c_str(), sizeof(rules.name) - 1);
+    rules.columns = spec.columns > 0 ? spec.columns : (N + 1) / 2;
+    rules.rounds = static_cast<int>(spec.schedule.size());
+    for (int r = 0; r < rules.rounds; r++) {
+        rules.casesPerRound[r] = spec.schedule[r];
+        if (spec.offers.empty()) {
+            double multiplier = spec.offerBase + ((r + 1) * spec.offerStep);
+            rules.offerMultiplier[r] = multiplier > spec.offerCap ? spec.offerCap : multiplier;
+        } else {
+            rules.offerMultiplier[r] = spec.offers[r];
+        }
+    }
+    rules.finalSwap = spec.finalSwap;
+    rules.builtin = false;
+
+    double prizes[N];
+    for (int i = 0; i < N; i++) prizes[i] = spec.prizes[i];
+    rules.board = makePrizeBoard(prizes);
+}
+
+// Call visit(Variant{}, rules) with the built-in rules of the variant
+// called `name`; false if there is none
+template <class Visitor>
+bool withBuiltinRules(std::string_view name, Visitor&& visit) {
+    return withVariant(name, [&visit](auto variant) {
+        visit(variant, BuiltinRules<decltype(variant)>);
+    });
+}
+
+// Call visit(Variant{}, rules) with rules built from a validated spec,
+// running on the compiled variant with the same number of cases
+template <class Visitor>
+bool withLoadedRules(const VariantSpec& spec, Visitor&& visit) {
+    bool found = false;
+    forEachVariant([&](auto variant) {
+        using Variant = decltype(variant);
+        if (found || static_cast<int>(spec.prizes.size()) != Variant::Cases) return;
+        found = true;
+        BasicGameRules<Variant::Cases> rules;
+        buildRules(spec, rules);
+        visit(variant, static_cast<const BasicGameRules<Variant::Cases>&>(rules));
+    });
+    return found;
+}
+
+#endif // DEALMASTER_VARIANT_RULES_H